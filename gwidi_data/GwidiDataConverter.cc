@@ -8,7 +8,7 @@ GwidiDataConverter &GwidiDataConverter::getInstance() {
     return instance;
 }
 
-gui::GwidiGuiData* GwidiDataConverter::midiToGui(midi::GwidiMidiData* data) {
+gui::GwidiGuiData* GwidiDataConverter::midiToGui(const midi::GwidiMidiData* data) {
     auto ret = new gui::GwidiGuiData();
     if(data->getTracks().empty()) {
         return ret;
@@ -18,14 +18,29 @@ gui::GwidiGuiData* GwidiDataConverter::midiToGui(midi::GwidiMidiData* data) {
     double originalTempo = 60 / data->getTempo(); // Tempo for midi parsed data is already in TPQ format
     double sixteenthNoteTPQ = 15 / originalTempo;
     int perMeasure = gwidi::options2::GwidiOptions2::getInstance().notesPerMeasure();
-    for(auto &note : track.notes) {
+    // Through the tempo map songs with tempo changes stay on the grid, otherwise fall back to the single tempo
+    auto &tempoMap = data->getTempoMap();
+    int perQuarter = perMeasure / 4;
+    // Only start, octave and key are needed, so walk those columns instead of materializing each note
+    auto &starts = track.notes.startOffsets();
+    auto &octaves = track.notes.octaves();
+    auto &keys = track.notes.keys();
+    for(std::size_t i = 0; i < starts.size(); i++) {
         // determine the # of measure from our start time
         // determine the # of octave from the note
+        double start = starts[i];
 
-        auto timeIndex = int(ceil(note.start_offset / sixteenthNoteTPQ));
+        int timeIndex;
+        if(!tempoMap.empty()) {
+            timeIndex = tempoMap.gridIndexAtSeconds(start, perQuarter);
+        }
+        else {
+            // Small tolerance so notes sitting on a grid line (give or take float error) don't round up to the next one
+            timeIndex = int(ceil(start / sixteenthNoteTPQ - 0.000001));
+        }
         int measureIndex = timeIndex / perMeasure;
         int timeInMeasure = timeIndex % perMeasure;
-        spdlog::debug("midiToGui, note start: {}, timeIndex: {}, measureIndex: {}", note.start_offset, timeIndex, measureIndex);
+        spdlog::debug("midiToGui, note start: {}, timeIndex: {}, measureIndex: {}", start, timeIndex, measureIndex);
 
         auto &retMeasures = ret->getMeasures();
 
@@ -35,10 +50,10 @@ gui::GwidiGuiData* GwidiDataConverter::midiToGui(midi::GwidiMidiData* data) {
         }
 
         auto &measure = retMeasures.at(measureIndex);
-        auto &octave = measure.octaves.at(note.octave); // This may be an issue, depending on how octave index vs octave num is handled
+        auto &octave = measure.octaves.at(octaves[i]); // This may be an issue, depending on how octave index vs octave num is handled
         // TODO: possibly add the separation? (octave num vs index) to make it more clear in our data usage
         for(auto &retNote : octave.notes[timeInMeasure]) {
-            if(retNote.key == note.key) {
+            if(retNote.key == keys[i]) {
                 ret->toggleNote(&retNote);
                 break;
             }
@@ -47,6 +62,14 @@ gui::GwidiGuiData* GwidiDataConverter::midiToGui(midi::GwidiMidiData* data) {
     return ret;
 }
 
+gui::GwidiGuiData* GwidiDataConverter::midiToGui(const midi::GwidiMidiSnapshot& data) {
+    return midiToGui(data.get());
+}
+
+midi::GwidiMidiSnapshot GwidiDataConverter::guiToMidiSnapshot(gui::GwidiGuiData* data) {
+    return midi::GwidiMidiData::snapshot(guiToMidi(data));
+}
+
 // TODO: instead of "default", pull this from some selected configuration value provided by GUI
 midi::GwidiMidiData* GwidiDataConverter::guiToMidi(gui::GwidiGuiData* data) {
     auto ret = new midi::GwidiMidiData();
@@ -79,7 +102,6 @@ midi::GwidiMidiData* GwidiDataConverter::guiToMidi(gui::GwidiGuiData* data) {
         }
     }
     ret->addTrack("default", "gwidi_gui", notes, data->trackDuration());
-    ret->fillTickMap();
     return ret;
 }
 
@@ -28,18 +28,22 @@ void GwidiGuiData::addMeasure() {
         Octave o;
         o.num = octave.num;
         o.measure = measure.num;
+        // Intern the option strings once, every time slot shares them
+        std::vector<Note> templateNotes;
+        for(auto &note : octave.notes) {
+            templateNotes.emplace_back(Note{
+                std::vector<Symbol>(note.letters.begin(), note.letters.end()),
+                measure.num,
+                o.num,
+                0,
+                note.key,
+                false
+            });
+        }
         for(auto i = 0; i < 16; i++) {
-            o.notes[i] = std::vector<Note>();
-            for(auto &note : octave.notes) {
-                Note n {
-                    note.letters,
-                    measure.num,
-                    o.num,
-                    i,
-                    note.key,
-                    false
-                };
-                o.notes[i].emplace_back(n);
+            o.notes[i] = templateNotes;
+            for(auto &n : o.notes[i]) {
+                n.time = i;
             }
         }
         measure.octaves.emplace_back(o);
@@ -53,19 +57,11 @@ void GwidiGuiData::toggleNote(Note *note) {
 
     // Assign based on offset time (which is a function of time and tempo)
     double offset = timeIndexToTickOffset(note);
-    auto tickIt = m_tickMap.find(offset);
-    if(tickIt == m_tickMap.end()) {
-        m_tickMap[offset] = std::vector<Note>();
-    }
-    auto &notes = m_tickMap[offset];
-    auto notesIt = std::find_if(notes.begin(), notes.end(), [note](const Note& n){
+    auto erased = m_tickMap.eraseIf(offset, [note](const Note& n){
         return n.measure == note->measure && n.octave == note->octave && n.time == note->time && n.key == note->key;
     });
-    if(notesIt != notes.end()) {
-        notes.erase(notesIt);
-    }
-    else {
-        notes.emplace_back(Note{*note});
+    if(!erased) {
+        m_tickMap.insert(offset, Note{*note});
     }
 }
 
@@ -76,7 +72,7 @@ double GwidiGuiData::trackDuration() {
     return timeIndexToTickOffset(&note) + 1.0;
 }
 
-double GwidiGuiData::timeIndexToTickOffset(Note* note) const {
+double GwidiGuiData::timeIndexToTickOffset(const Note* note) const {
     if(!note) {
         return 0.0;
     }
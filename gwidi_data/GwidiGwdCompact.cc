@@ -0,0 +1,238 @@
+#include "GwidiMidiData.h"
+#include "GwidiGwdFormat.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace gwidi::data::midi {
+
+namespace {
+// Runs of equal entries as {value, run length}, value(entry) is only called once per run
+template<typename Column, typename ValueFn>
+void putRuns(std::vector<std::uint8_t> &out, const Column &column, ValueFn value) {
+    std::size_t i = 0;
+    while (i < column.size()) {
+        std::size_t run = 1;
+        while (i + run < column.size() && column[i + run] == column[i]) {
+            run++;
+        }
+        gwd::putVarint(out, value(column[i]));
+        gwd::putVarint(out, run);
+        i += run;
+    }
+}
+
+template<typename Column, typename FromFn>
+bool readRuns(gwd::ByteReader &in, std::size_t count, Column &out, FromFn from) {
+    out.resize(count);
+    std::size_t i = 0;
+    while (i < count) {
+        std::uint64_t value;
+        std::uint64_t run;
+        if (!in.varint(value) || !in.varint(run) || run == 0 || run > count - i) {
+            return false;
+        }
+        std::fill_n(out.begin() + i, run, from(value));
+        i += run;
+    }
+    return true;
+}
+}
+
+std::vector<std::uint8_t> GwidiMidiData::encodeCompact() const {
+    gwd::Header header;
+    header.version = gwd::s_compactVersion;
+    header.quantum_ns = gwd::s_compactQuantumNs;
+    header.track_count = std::uint32_t(tracks.size());
+    header.tempo = tempo;
+    header.tempo_micro = tempoMicro;
+    header.ticks_per_quarter = tempoMap.ticksPerQuarter();
+    header.tempo_segment_count = std::uint32_t(tempoMap.getSegments().size());
+    double perSecond = 1e9 / header.quantum_ns;
+
+    // Every string gets its id up front, the table is written ahead of the columns using it
+    gwd::StringTable strings;
+    for (auto &t: tracks) {
+        strings.id(t.instrument_name);
+        strings.id(t.track_name);
+        for (auto column: {&t.notes.keys(), &t.notes.letters(), &t.notes.instruments()}) {
+            Symbol last;
+            for (auto &symbol: *column) {
+                if (symbol != last) {
+                    strings.id(symbol);
+                    last = symbol;
+                }
+            }
+        }
+        header.note_count += t.notes.size();
+    }
+    header.string_count = std::uint32_t(strings.strings().size());
+
+    std::vector<std::uint8_t> out(gwd::s_headerSize);
+    out.reserve(gwd::s_headerSize + header.note_count * 4);
+    for (auto str: strings.strings()) {
+        gwd::putVarint(out, str.size());
+        out.insert(out.end(), str.begin(), str.end());
+    }
+
+    std::int64_t lastTick = 0;
+    for (auto &s: tempoMap.getSegments()) {
+        gwd::putVarint(out, gwd::zigzag(s.tick - lastTick));
+        gwd::putFixed<double>(out, s.microseconds);
+        lastTick = s.tick;
+    }
+
+    auto symbolId = [&strings](const Symbol &symbol) {
+        return std::uint64_t(strings.id(symbol));
+    };
+    auto signedValue = [](std::int64_t value) {
+        return gwd::zigzag(value);
+    };
+    std::vector<std::int64_t> durations;
+    for (auto &t: tracks) {
+        gwd::putFixed<double>(out, t.durationInSeconds);
+        gwd::putVarint(out, strings.id(t.instrument_name));
+        gwd::putVarint(out, strings.id(t.track_name));
+        gwd::putVarint(out, t.notes.size());
+
+        // Notes mostly come in start order, so each start is a small step from the last
+        std::int64_t lastStart = 0;
+        for (auto start: t.notes.startOffsets()) {
+            auto quantized = std::llround(start * perSecond);
+            gwd::putVarint(out, gwd::zigzag(quantized - lastStart));
+            lastStart = quantized;
+        }
+        durations.resize(t.notes.size());
+        std::transform(t.notes.durations().begin(), t.notes.durations().end(), durations.begin(), [perSecond](double d) {
+            return std::int64_t(std::llround(d * perSecond));
+        });
+        putRuns(out, durations, signedValue);
+        putRuns(out, t.notes.keys(), symbolId);
+        putRuns(out, t.notes.letters(), symbolId);
+        putRuns(out, t.notes.instruments(), symbolId);
+        putRuns(out, t.notes.tracks(), signedValue);
+        putRuns(out, t.notes.octaves(), signedValue);
+    }
+
+    header.body_size = out.size() - gwd::s_headerSize;
+    gwd::writeHeader(out.data(), header);
+    header.crc = gwd::checksum(out.data(), header.body_size);
+    gwd::writeHeader(out.data(), header);
+    return out;
+}
+
+// The checksum was already checked by readFromMemory
+GwidiMidiData *GwidiMidiData::readCompact(const std::uint8_t *data, std::size_t size) {
+    gwd::Header header;
+    if (!gwd::readHeader(data, size, header) || header.version != gwd::s_compactVersion) {
+        return nullptr;
+    }
+    gwd::ByteReader in(data + gwd::s_headerSize, header.body_size);
+    double perSecond = 1e9 / header.quantum_ns;
+
+    // Track names are copied straight out, only strings the note columns use get interned, once each
+    std::vector<std::string_view> strings(header.string_count);
+    for (auto &str: strings) {
+        std::uint64_t length;
+        const std::uint8_t *bytes;
+        if (!in.varint(length) || !in.bytes(length, bytes)) {
+            spdlog::warn("readCompact string table is truncated");
+            return nullptr;
+        }
+        str = std::string_view(reinterpret_cast<const char *>(bytes), length);
+    }
+    std::vector<Symbol> symbols(strings.size());
+    std::vector<bool> interned(strings.size(), false);
+    auto toSymbol = [&strings, &symbols, &interned](std::uint64_t id) {
+        if (id >= strings.size()) {
+            return Symbol();
+        }
+        if (!interned[id]) {
+            symbols[id] = Symbol(strings[id]);
+            interned[id] = true;
+        }
+        return symbols[id];
+    };
+
+    std::unique_ptr<GwidiMidiData> outData(new GwidiMidiData(std::size_t(header.note_count)));
+    outData->tempo = header.tempo;
+    outData->tempoMicro = header.tempo_micro;
+
+    if (header.tempo_segment_count > 0) {
+        std::vector<TempoChange> changes(header.tempo_segment_count);
+        std::int64_t tick = 0;
+        for (auto &change: changes) {
+            std::uint64_t delta;
+            if (!in.varint(delta) || !in.fixed<double>(change.microseconds)) {
+                spdlog::warn("readCompact tempo map is truncated");
+                return nullptr;
+            }
+            tick += gwd::unzigzag(delta);
+            change.tick = tick;
+        }
+        outData->tempoMap = TempoMap(header.ticks_per_quarter, changes);
+    }
+
+    std::uint64_t notesLeft = header.note_count;
+    for (std::size_t i = 0; i < header.track_count; i++) {
+        double duration;
+        std::uint64_t instrumentName;
+        std::uint64_t trackName;
+        std::uint64_t count;
+        if (!in.fixed<double>(duration) || !in.varint(instrumentName) || !in.varint(trackName) || !in.varint(count) ||
+            instrumentName >= strings.size() || trackName >= strings.size() || count > notesLeft) {
+            spdlog::warn("readCompact track {} is corrupt", i);
+            return nullptr;
+        }
+        notesLeft -= count;
+        outData->tracks.emplace_back(Track{
+                NoteColumns(outData->getArena()),
+                std::string(strings[instrumentName]),
+                std::string(strings[trackName]),
+                duration
+        });
+
+        auto &notes = outData->tracks.back().notes;
+        notes.m_startOffsets.resize(count);
+        std::int64_t start = 0;
+        for (auto &s: notes.m_startOffsets) {
+            std::uint64_t delta;
+            if (!in.varint(delta)) {
+                spdlog::warn("readCompact track {} starts are truncated", i);
+                return nullptr;
+            }
+            start += gwd::unzigzag(delta);
+            s = double(start) / perSecond;
+        }
+        auto toSeconds = [perSecond](std::uint64_t value) {
+            return double(gwd::unzigzag(value)) / perSecond;
+        };
+        auto toInt32 = [](std::uint64_t value) {
+            return std::int32_t(gwd::unzigzag(value));
+        };
+        auto toInt16 = [](std::uint64_t value) {
+            return std::int16_t(gwd::unzigzag(value));
+        };
+        if (!readRuns(in, count, notes.m_durations, toSeconds) ||
+            !readRuns(in, count, notes.m_keys, toSymbol) ||
+            !readRuns(in, count, notes.m_letters, toSymbol) ||
+            !readRuns(in, count, notes.m_instruments, toSymbol) ||
+            !readRuns(in, count, notes.m_tracks, toInt32) ||
+            !readRuns(in, count, notes.m_octaves, toInt16)) {
+            spdlog::warn("readCompact track {} columns are corrupt", i);
+            return nullptr;
+        }
+    }
+    if (!in.atEnd()) {
+        spdlog::warn("readCompact body has trailing bytes");
+        return nullptr;
+    }
+
+    if (!outData->tracks.empty()) {
+        outData->fillTickMap();
+    }
+    return outData.release();
+}
+
+}
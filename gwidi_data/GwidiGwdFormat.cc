@@ -0,0 +1,103 @@
+#include "GwidiGwdFormat.h"
+#include <array>
+
+namespace gwidi::data::midi::gwd {
+
+namespace {
+std::array<std::uint32_t, 256> makeCrcTable() {
+    std::array<std::uint32_t, 256> table{};
+    for(std::uint32_t i = 0; i < 256; i++) {
+        std::uint32_t c = i;
+        for(auto k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}
+}
+
+Sections sections(const Header &header) {
+    auto notes = std::size_t(header.note_count);
+    Sections s;
+    s.tracks = s_headerSize;
+    s.starts = align8(s.tracks + header.track_count * s_trackRecordSize);
+    s.durations = align8(s.starts + notes * sizeof(double));
+    s.keys = align8(s.durations + notes * sizeof(double));
+    s.letters = align8(s.keys + notes * sizeof(std::uint32_t));
+    s.instruments = align8(s.letters + notes * sizeof(std::uint32_t));
+    s.track_ids = align8(s.instruments + notes * sizeof(std::uint32_t));
+    s.octaves = align8(s.track_ids + notes * sizeof(std::int32_t));
+    s.tempo = align8(s.octaves + notes * sizeof(std::int16_t));
+    s.strings = align8(s.tempo + header.tempo_segment_count * s_tempoSegmentSize);
+    s.string_bytes = s.strings + (std::size_t(header.string_count) + 1) * sizeof(std::uint32_t);
+    return s;
+}
+
+bool isGwd(const std::uint8_t *data, std::size_t size) {
+    return size >= sizeof(s_magic) && std::memcmp(data, s_magic, sizeof(s_magic)) == 0;
+}
+
+bool readHeader(const std::uint8_t *data, std::size_t size, Header &out) {
+    if(size < s_headerSize || !isGwd(data, size)) {
+        return false;
+    }
+    out.version = loadLE<std::uint32_t>(data + 4);
+    out.crc = loadLE<std::uint32_t>(data + 8);
+    out.body_size = loadLE<std::uint64_t>(data + 16);
+    out.note_count = loadLE<std::uint64_t>(data + 24);
+    out.track_count = loadLE<std::uint32_t>(data + 32);
+    out.string_count = loadLE<std::uint32_t>(data + 36);
+    out.tempo_segment_count = loadLE<std::uint32_t>(data + 40);
+    out.tempo = loadLE<double>(data + 48);
+    out.tempo_micro = loadLE<double>(data + 56);
+    out.ticks_per_quarter = loadLE<double>(data + 64);
+    out.quantum_ns = loadLE<std::uint32_t>(data + 44);
+    if((out.version != s_version && out.version != s_compactVersion) || out.body_size > size - s_headerSize ||
+       out.note_count > out.body_size || out.string_count == 0 || out.string_count > out.body_size) {
+        return false;
+    }
+    // Every compact note takes at least its start byte, so note_count is still bounded by the body
+    // The other counts size allocations before anything is read, they have to fit in the body too
+    if(out.version == s_compactVersion) {
+        auto minimum = std::uint64_t(out.tempo_segment_count) * s_compactMinTempoSegmentSize +
+                       std::uint64_t(out.track_count) * s_compactMinTrackSize + out.string_count;
+        return out.quantum_ns > 0 && minimum <= out.body_size;
+    }
+    return sections(out).string_bytes <= s_headerSize + out.body_size;
+}
+
+void writeHeader(std::uint8_t *out, const Header &header) {
+    std::memcpy(out, s_magic, sizeof(s_magic));
+    storeLE<std::uint32_t>(out + 4, header.version);
+    storeLE<std::uint32_t>(out + 8, header.crc);
+    storeLE<std::uint32_t>(out + 12, 0);
+    storeLE<std::uint64_t>(out + 16, header.body_size);
+    storeLE<std::uint64_t>(out + 24, header.note_count);
+    storeLE<std::uint32_t>(out + 32, header.track_count);
+    storeLE<std::uint32_t>(out + 36, header.string_count);
+    storeLE<std::uint32_t>(out + 40, header.tempo_segment_count);
+    storeLE<std::uint32_t>(out + 44, header.quantum_ns);
+    storeLE<double>(out + 48, header.tempo);
+    storeLE<double>(out + 56, header.tempo_micro);
+    storeLE<double>(out + 64, header.ticks_per_quarter);
+}
+
+std::uint32_t crc32(const std::uint8_t *data, std::size_t size, std::uint32_t crc) {
+    static const auto table = makeCrcTable();
+    std::uint32_t c = crc ^ 0xFFFFFFFFu;
+    for(std::size_t i = 0; i < size; i++) {
+        c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+std::uint32_t checksum(const std::uint8_t *file, std::uint64_t bodySize) {
+    // The header counts and offsets decide what gets allocated and read, so they are covered too
+    std::uint8_t header[s_headerSize];
+    std::memcpy(header, file, s_headerSize);
+    storeLE<std::uint32_t>(header + 8, 0);
+    return crc32(file + s_headerSize, std::size_t(bodySize), crc32(header, s_headerSize));
+}
+
+}
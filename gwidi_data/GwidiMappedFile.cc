@@ -0,0 +1,83 @@
+#include "GwidiMappedFile.h"
+#include "spdlog/spdlog.h"
+#include <fstream>
+#include <iterator>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace gwidi::data {
+
+MappedFile::MappedFile(const std::string &filename) {
+#if defined(__linux__)
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd == -1) {
+        spdlog::warn("MappedFile failed to open: {}", filename);
+        return;
+    }
+    struct stat st{};
+    if(fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr != MAP_FAILED) {
+            m_data = static_cast<const std::uint8_t*>(addr);
+            m_size = st.st_size;
+            m_mapped = true;
+        }
+    }
+    ::close(fd);
+    if(m_mapped) {
+        return;
+    }
+#endif
+    // Not mappable (or not supported), read it in instead
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    if(!in.is_open()) {
+        spdlog::warn("MappedFile failed to open: {}", filename);
+        return;
+    }
+    m_fallback.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if(!m_fallback.empty()) {
+        m_data = m_fallback.data();
+        m_size = m_fallback.size();
+    }
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if(this != &other) {
+        close();
+        m_fallback = std::move(other.m_fallback);
+        m_mapped = other.m_mapped;
+        m_size = other.m_size;
+        m_data = m_mapped ? other.m_data : (m_fallback.empty() ? nullptr : m_fallback.data());
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_mapped = false;
+    }
+    return *this;
+}
+
+void MappedFile::close() {
+#if defined(__linux__)
+    if(m_mapped && m_data) {
+        munmap(const_cast<std::uint8_t*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_fallback.clear();
+}
+
+}
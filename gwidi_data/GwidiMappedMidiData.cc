@@ -0,0 +1,215 @@
+#include "GwidiMappedMidiData.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+
+namespace gwidi::data::midi {
+
+MappedTrack::MappedTrack(const GwidiMappedMidiData *file, const std::uint8_t *record) : m_file{file} {
+    m_duration = gwd::loadLE<double>(record);
+    m_first = std::size_t(gwd::loadLE<std::uint64_t>(record + 8));
+    m_count = gwd::loadLE<std::uint32_t>(record + 16);
+    m_instrumentName = gwd::loadLE<std::uint32_t>(record + 20);
+    m_trackName = gwd::loadLE<std::uint32_t>(record + 24);
+    m_flags = gwd::loadLE<std::uint32_t>(record + 28);
+}
+
+std::string_view MappedTrack::instrumentName() const {
+    return m_file->string(m_instrumentName);
+}
+
+std::string_view MappedTrack::trackName() const {
+    return m_file->string(m_trackName);
+}
+
+MappedColumn<double> MappedTrack::startOffsets() const {
+    return {m_file->m_file.data() + m_file->m_sections.starts + m_first * sizeof(double), m_count};
+}
+
+MappedColumn<double> MappedTrack::durations() const {
+    return {m_file->m_file.data() + m_file->m_sections.durations + m_first * sizeof(double), m_count};
+}
+
+MappedColumn<std::uint32_t> MappedTrack::keyIds() const {
+    return {m_file->m_file.data() + m_file->m_sections.keys + m_first * sizeof(std::uint32_t), m_count};
+}
+
+MappedColumn<std::uint32_t> MappedTrack::letterIds() const {
+    return {m_file->m_file.data() + m_file->m_sections.letters + m_first * sizeof(std::uint32_t), m_count};
+}
+
+MappedColumn<std::uint32_t> MappedTrack::instrumentIds() const {
+    return {m_file->m_file.data() + m_file->m_sections.instruments + m_first * sizeof(std::uint32_t), m_count};
+}
+
+MappedColumn<std::int32_t> MappedTrack::tracks() const {
+    return {m_file->m_file.data() + m_file->m_sections.track_ids + m_first * sizeof(std::int32_t), m_count};
+}
+
+MappedColumn<std::int16_t> MappedTrack::octaves() const {
+    return {m_file->m_file.data() + m_file->m_sections.octaves + m_first * sizeof(std::int16_t), m_count};
+}
+
+Note MappedTrack::note(std::size_t index) const {
+    return Note{
+            startOffsets()[index],
+            durations()[index],
+            octaves()[index],
+            Symbol(m_file->string(letterIds()[index])),
+            Symbol(m_file->string(instrumentIds()[index])),
+            tracks()[index],
+            Symbol(m_file->string(keyIds()[index]))
+    };
+}
+
+
+bool GwidiMappedMidiData::open(const std::string &filename, bool verifyChecksum) {
+    m_header = gwd::Header{};
+    m_index.clear();
+    m_file = MappedFile(filename);
+    if(!m_file.isOpen()) {
+        return false;
+    }
+
+    if(!gwd::readHeader(m_file.data(), m_file.size(), m_header)) {
+        spdlog::warn("GwidiMappedMidiData not a v2 .gwd file: {}", filename);
+        m_header = gwd::Header{};
+        return false;
+    }
+    if(m_header.version != gwd::s_version) {
+        spdlog::warn("GwidiMappedMidiData compact .gwd files have to be decoded, use GwidiMidiData::readFromFile: {}", filename);
+        m_header = gwd::Header{};
+        return false;
+    }
+    if(verifyChecksum && gwd::checksum(m_file.data(), m_header.body_size) != m_header.crc) {
+        spdlog::warn("GwidiMappedMidiData checksum does not match: {}", filename);
+        m_header = gwd::Header{};
+        return false;
+    }
+    m_sections = gwd::sections(m_header);
+
+    // Per track, not per note, so still cheap for any song size
+    for(std::size_t i = 0; i < m_header.track_count; i++) {
+        auto record = m_file.data() + m_sections.tracks + i * gwd::s_trackRecordSize;
+        auto first = gwd::loadLE<std::uint64_t>(record + 8);
+        auto count = gwd::loadLE<std::uint32_t>(record + 16);
+        if(first > m_header.note_count || count > m_header.note_count - first) {
+            spdlog::warn("GwidiMappedMidiData track {} is out of bounds: {}", i, filename);
+            m_header = gwd::Header{};
+            return false;
+        }
+    }
+
+    // A single track in start order is searched in place, anything else needs an index to find notes by time
+    if(m_header.track_count > 1 || (m_header.track_count == 1 && !track(0).sortedByStart())) {
+        std::vector<MappedColumn<double>> starts;
+        std::pmr::vector<NoteRef> refs;
+        refs.reserve(m_header.note_count);
+        for(std::uint32_t t = 0; t < m_header.track_count; t++) {
+            starts.emplace_back(track(t).startOffsets());
+            for(std::uint32_t i = 0; i < starts.back().size(); i++) {
+                refs.emplace_back(NoteRef{t, i});
+            }
+        }
+        // Stable, so notes of one start time stay by track then index, the order fillTickMap merges them in
+        auto start = [&starts](const NoteRef &ref) {
+            return starts[ref.track][ref.index];
+        };
+        std::stable_sort(refs.begin(), refs.end(), [&start](const NoteRef &a, const NoteRef &b) {
+            return toTimeline(start(a)) < toTimeline(start(b));
+        });
+        m_index.assignSorted(std::move(refs), start);
+    }
+    return true;
+}
+
+TempoMap GwidiMappedMidiData::tempoMap() const {
+    if(m_header.tempo_segment_count == 0) {
+        return TempoMap();
+    }
+    std::vector<TempoChange> changes(m_header.tempo_segment_count);
+    for(std::size_t i = 0; i < changes.size(); i++) {
+        auto segment = m_file.data() + m_sections.tempo + i * gwd::s_tempoSegmentSize;
+        changes[i].tick = gwd::loadLE<std::int64_t>(segment);
+        changes[i].microseconds = gwd::loadLE<double>(segment + 8);
+    }
+    return TempoMap(m_header.ticks_per_quarter, changes);
+}
+
+MappedTrack GwidiMappedMidiData::track(std::size_t index) const {
+    return MappedTrack(this, m_file.data() + m_sections.tracks + index * gwd::s_trackRecordSize);
+}
+
+std::string_view GwidiMappedMidiData::string(std::uint32_t id) const {
+    if(id >= m_header.string_count) {
+        return {};
+    }
+    auto begin = gwd::loadLE<std::uint32_t>(m_file.data() + m_sections.strings + id * sizeof(std::uint32_t));
+    auto end = gwd::loadLE<std::uint32_t>(m_file.data() + m_sections.strings + (id + 1) * sizeof(std::uint32_t));
+    auto available = gwd::s_headerSize + m_header.body_size - m_sections.string_bytes;
+    if(begin > end || end > available) {
+        return {};
+    }
+    return {reinterpret_cast<const char*>(m_file.data() + m_sections.string_bytes + begin), end - begin};
+}
+
+double GwidiMappedMidiData::longestTrackDuration() const {
+    double longest{0};
+    for(std::size_t i = 0; i < trackCount(); i++) {
+        longest = std::max(longest, track(i).durationInSeconds());
+    }
+    return longest;
+}
+
+GwidiMappedMidiData::NoteRange GwidiMappedMidiData::floorNotes(double time) const {
+    NoteRange range;
+    if(m_header.track_count == 0) {
+        return range;
+    }
+    if(m_header.track_count > 1 || !track(0).sortedByStart()) {
+        auto index = m_index.floorIndex(time);
+        if(index != m_index.npos) {
+            range.time = m_index.keyAt(index);
+            range.refs = m_index.notesAtIndex(index);
+        }
+        return range;
+    }
+
+    auto starts = track(0).startOffsets();
+    if(starts.size() == 0) {
+        return range;
+    }
+    // First note at or after value, on the tick maps' time base
+    auto lowerBound = [&starts](TimelineTime value) {
+        std::size_t lo = 0;
+        std::size_t hi = starts.size();
+        while(lo < hi) {
+            auto mid = lo + (hi - lo) / 2;
+            if(toTimeline(starts[mid]) < value) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        return lo;
+    };
+    // Same 3 cases as FlatTickMap::floorIndex, over the distinct start times
+    auto bound = lowerBound(toTimeline(time));
+    auto floorTime = toTimeline(bound == 0 ? starts[0] : starts[bound - 1]);
+    range.time = toSeconds(floorTime);
+    range.begin = lowerBound(floorTime);
+    range.end = range.begin;
+    while(range.end < starts.size() && toTimeline(starts[range.end]) == floorTime) {
+        range.end++;
+    }
+    return range;
+}
+
+GwidiMidiData *GwidiMappedMidiData::toMidiData() const {
+    if(!isOpen()) {
+        return nullptr;
+    }
+    return GwidiMidiData::readFromMemory(m_file.data(), gwd::s_headerSize + m_header.body_size);
+}
+
+}
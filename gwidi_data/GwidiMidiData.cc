@@ -1,67 +1,382 @@
 #include "GwidiMidiData.h"
 #include "spdlog/spdlog.h"
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include "GwidiGwdFormat.h"
 
 namespace gwidi::data::midi {
 
-GwidiMidiData::GwidiMidiData(const std::vector<Track> &tracks) {
-    this->tracks.clear();
+namespace {
+// Columns plus a tick map entry per note, and room for the vectors' alignment
+std::size_t arenaBytes(std::size_t noteCount) {
+    constexpr std::size_t perNote = sizeof(double) * 2 + sizeof(std::int16_t) + sizeof(std::int32_t) + sizeof(Symbol) * 3 +
+                                    sizeof(TimelineTime) + sizeof(std::uint32_t) + sizeof(NoteRef);
+    return std::max<std::size_t>(noteCount * perNote, 4096);
+}
+
+std::size_t noteCount(const std::vector<Track> &tracks) {
+    std::size_t count = 0;
     for (auto &t: tracks) {
-        this->tracks.emplace_back(Track(t));
+        count += t.notes.size();
     }
+    return count;
 }
 
-GwidiMidiData::GwidiMidiData(std::vector<Track> &&tracks) {
-    this->tracks = std::move(tracks);
+// Platform independent, the words are mixed in as numbers and strings are read little-endian
+class ContentHash {
+public:
+    inline void addWord(std::uint64_t value) {
+        m_hash ^= value * 0x9E3779B97F4A7C15ull;
+        m_hash = ((m_hash << 31) | (m_hash >> 33)) * 0xBF58476D1CE4E5B9ull;
+    }
+    // Equal doubles hash the same, 0.0 and -0.0 included
+    inline void addDouble(double value) {
+        std::uint64_t bits = 0;
+        if (value != 0.0) {
+            std::memcpy(&bits, &value, sizeof(bits));
+        }
+        addWord(bits);
+    }
+    void addString(const std::string &str) {
+        addWord(str.size());
+        std::size_t i = 0;
+        for (; i + 8 <= str.size(); i += 8) {
+            addWord(gwd::loadLE<std::uint64_t>(reinterpret_cast<const std::uint8_t *>(str.data() + i)));
+        }
+        std::uint64_t tail = 0;
+        for (std::size_t shift = 0; i < str.size(); i++, shift += 8) {
+            tail |= std::uint64_t(std::uint8_t(str[i])) << shift;
+        }
+        addWord(tail);
+    }
+    // Final avalanche so nearby inputs land far apart
+    inline std::uint64_t value() const {
+        auto h = m_hash;
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+        return h ^ (h >> 31);
+    }
+
+    static std::uint64_t ofString(const std::string &str) {
+        ContentHash hash;
+        hash.addString(str);
+        return hash.value();
+    }
+
+private:
+    std::uint64_t m_hash{0x243F6A8885A308D3ull};
+};
+}
+
+NoteColumns::NoteColumns(std::pmr::memory_resource *resource) :
+        m_startOffsets{resource},
+        m_durations{resource},
+        m_octaves{resource},
+        m_tracks{resource},
+        m_keys{resource},
+        m_letters{resource},
+        m_instruments{resource} {
+}
+
+void NoteColumns::reserve(std::size_t count) {
+    m_startOffsets.reserve(count);
+    m_durations.reserve(count);
+    m_octaves.reserve(count);
+    m_tracks.reserve(count);
+    m_keys.reserve(count);
+    m_letters.reserve(count);
+    m_instruments.reserve(count);
+}
+
+void NoteColumns::clear() {
+    m_startOffsets.clear();
+    m_durations.clear();
+    m_octaves.clear();
+    m_tracks.clear();
+    m_keys.clear();
+    m_letters.clear();
+    m_instruments.clear();
+}
+
+void NoteColumns::emplace_back(const Note &note) {
+    m_startOffsets.emplace_back(note.start_offset);
+    m_durations.emplace_back(note.duration);
+    m_octaves.emplace_back(std::int16_t(note.octave));
+    m_tracks.emplace_back(note.track);
+    m_keys.emplace_back(note.key);
+    m_letters.emplace_back(note.letter);
+    m_instruments.emplace_back(note.instrument);
+}
+
+void NoteColumns::erase(std::size_t index) {
+    m_startOffsets.erase(m_startOffsets.begin() + index);
+    m_durations.erase(m_durations.begin() + index);
+    m_octaves.erase(m_octaves.begin() + index);
+    m_tracks.erase(m_tracks.begin() + index);
+    m_keys.erase(m_keys.begin() + index);
+    m_letters.erase(m_letters.begin() + index);
+    m_instruments.erase(m_instruments.begin() + index);
+}
+
+Note NoteColumns::at(std::size_t index) const {
+    return Note{
+            m_startOffsets.at(index),
+            m_durations[index],
+            m_octaves[index],
+            m_letters[index],
+            m_instruments[index],
+            m_tracks[index],
+            m_keys[index]
+    };
+}
+
+std::size_t NoteColumns::memoryUsage() const {
+    return size() * (sizeof(double) * 2 + sizeof(std::int16_t) + sizeof(std::int32_t) + sizeof(Symbol) * 3);
+}
+
+bool NoteColumns::operator==(const NoteColumns &rhs) const {
+    return m_startOffsets == rhs.m_startOffsets &&
+           m_durations == rhs.m_durations &&
+           m_octaves == rhs.m_octaves &&
+           m_tracks == rhs.m_tracks &&
+           m_keys == rhs.m_keys &&
+           m_letters == rhs.m_letters &&
+           m_instruments == rhs.m_instruments;
+}
+
+GwidiMidiData::GwidiMidiData() : GwidiMidiData(std::size_t(0)) {
+}
+
+GwidiMidiData::GwidiMidiData(std::size_t noteCount) :
+        arenaUpstream{std::make_unique<ArenaUpstream>()},
+        arena{std::make_unique<std::pmr::monotonic_buffer_resource>(arenaBytes(noteCount), arenaUpstream.get())},
+        tickMap{arena.get()} {
+}
+
+GwidiMidiData::GwidiMidiData(const std::vector<Track> &tracks) : GwidiMidiData(noteCount(tracks)) {
+    for (auto &t: tracks) {
+        appendTrackCopy(t);
+    }
+    refreshTickMap();
+}
+
+void GwidiMidiData::appendTrackCopy(const Track &t) {
+    tracks.emplace_back(Track{NoteColumns(arena.get()), t.instrument_name, t.track_name, t.durationInSeconds});
+    // Copy assignment keeps the target's allocator, so the notes land in the arena
+    tracks.back().notes = t.notes;
+}
+
+void GwidiMidiData::appendTrack(Track &&t) {
+    tracks.emplace_back(Track{NoteColumns(arena.get()), std::move(t.instrument_name), std::move(t.track_name), t.durationInSeconds});
+    // Move assignment across resources copies into the target's, the columns can't keep pointing at another song's arena
+    tracks.back().notes = std::move(t.notes);
+}
+
+GwidiMidiData::GwidiMidiData(std::vector<Track> &&tracks) : GwidiMidiData(noteCount(tracks)) {
+    for (auto &t: tracks) {
+        appendTrack(std::move(t));
+    }
+    // What's left behind still lives in the tracks' own resources, release it while those are alive
+    tracks.clear();
+    refreshTickMap();
 }
 
 void GwidiMidiData::assignNotes(int track, const std::vector<Note> &in_notes) {
-    this->tracks[track] = Track();
+    if (track < 0 || std::size_t(track) >= this->tracks.size()) {
+        return;
+    }
+    invalidateFingerprint();
+    // Refilled in place, new columns would leave the old ones behind in the arena
+    auto &t = this->tracks[track];
+    t.notes.clear();
+    t.instrument_name.clear();
+    t.track_name.clear();
+    t.durationInSeconds = 0.0;
+    t.notes.reserve(in_notes.size());
     for (auto &note: in_notes) {
-        this->tracks[track].notes.emplace_back(Note(note));
+        t.notes.emplace_back(Note(note));
     }
+    refreshTickMap();
 }
 
 void GwidiMidiData::addNote(int track, Note &note) {
-    if (track >= 0 && track < this->tracks.size()) {
-        this->tracks[track].notes.emplace_back(Note(note));
+    if (track < 0 || std::size_t(track) >= this->tracks.size()) {
+        return;
+    }
+    invalidateFingerprint();
+    auto &notes = this->tracks[track].notes;
+    notes.emplace_back(Note(note));
+    if (editDepth > 0) {
+        tickMapStale = true;
+        return;
+    }
+    // Notes added in time order append to the map, earlier ones shift the entries after them up
+    // Placed among the notes of its time the same way fillTickMap orders them
+    tickMap.insert(note.start_offset, NoteRef{std::uint32_t(track), std::uint32_t(notes.size() - 1)}, std::less<NoteRef>());
+}
+
+void GwidiMidiData::removeNote(int track, std::size_t index) {
+    if (track < 0 || std::size_t(track) >= this->tracks.size() || index >= this->tracks[track].notes.size()) {
+        return;
+    }
+    invalidateFingerprint();
+    auto &notes = this->tracks[track].notes;
+    auto start = notes.startOffsets()[index];
+    notes.erase(index);
+    if (editDepth > 0) {
+        tickMapStale = true;
+        return;
+    }
+    NoteRef removed{std::uint32_t(track), std::uint32_t(index)};
+    tickMap.eraseIf(start, [removed](const NoteRef &ref) {
+        return ref == removed;
+    });
+    // Every note of the track after it moved down one, found through its own start time rather than a pass over
+    // every ref in the map. Lowest index first, so a shifted ref never meets one still waiting to shift.
+    // Still O(total notes) in the worst case: eraseIf moves the note array down one behind the removed ref
+    auto &starts = notes.startOffsets();
+    for (auto i = index; i < notes.size(); i++) {
+        NoteRef moved{removed.track, std::uint32_t(i + 1)};
+        tickMap.updateNotesAt(starts[i], [moved](NoteRef &ref) {
+            if (ref == moved) {
+                ref.index--;
+            }
+        });
     }
 }
 
 void GwidiMidiData::assignTempo(double t, double tm) {
+    invalidateFingerprint();
     this->tempo = t;
     this->tempoMicro = tm;
 }
 
+void GwidiMidiData::assignTempoMap(TempoMap map) {
+    invalidateFingerprint();
+    this->tempoMap = std::move(map);
+}
+
 void GwidiMidiData::addTrack(std::string instrument, std::string track_name, const std::vector<Note> &notes,
                              double trackDurationInSeconds) {
+    invalidateFingerprint();
     this->tracks.emplace_back(Track{
-            std::vector<Note>(),
+            NoteColumns(arena.get()),
             std::move(instrument),
             std::move(track_name),
             trackDurationInSeconds
     });
+    this->tracks.back().notes.reserve(notes.size());
     for (auto &n: notes) {
-        this->tracks.back().notes.emplace_back(Note(n));
+        this->tracks.back().notes.emplace_back(n);
+    }
+    refreshTickMap();
+}
+
+void GwidiMidiData::beginEdit() {
+    editDepth++;
+}
+
+void GwidiMidiData::commitEdit() {
+    if (editDepth == 0 || --editDepth > 0) {
+        return;
+    }
+    if (tickMapStale) {
+        tickMapStale = false;
+        fillTickMap();
     }
 }
 
+void GwidiMidiData::refreshTickMap() {
+    if (editDepth > 0) {
+        tickMapStale = true;
+        return;
+    }
+    fillTickMap();
+}
+
 void GwidiMidiData::fillTickMap() {
     tickMap.clear();
+    std::size_t noteCount = 0;
+    for (auto &t: tracks) {
+        noteCount += t.notes.size();
+    }
+    spdlog::debug("fillTickMap  merging {} tracks with #{} notes", tracks.size(), noteCount);
+    if (noteCount == 0) {
+        return;
+    }
+
+    // Each track on its own in start order first, ordered on the map's time base so starts a float error apart tie
+    // Notes are almost always in start order already, then that is a single pass and no copy
+    auto earlier = [](double a, double b) {
+        return toTimeline(a) < toTimeline(b);
+    };
+    std::vector<std::vector<std::uint32_t>> orders(tracks.size());
+    for (std::size_t i = 0; i < tracks.size(); i++) {
+        auto &starts = tracks[i].notes.startOffsets();
+        if (std::is_sorted(starts.begin(), starts.end(), earlier)) {
+            continue;
+        }
+        orders[i].resize(starts.size());
+        std::iota(orders[i].begin(), orders[i].end(), 0);
+        std::stable_sort(orders[i].begin(), orders[i].end(), [&starts, &earlier](std::uint32_t a, std::uint32_t b) {
+            return earlier(starts[a], starts[b]);
+        });
+    }
+
+    // Then a k-way merge of the sorted tracks, a heap holding the next note of each
+    // Notes of one start time come out by track, then in their track's order
+    struct Cursor {
+        TimelineTime start;
+        std::uint32_t track;
+        std::uint32_t position;
+    };
+    auto later = [](const Cursor &a, const Cursor &b) {
+        return a.start > b.start || (a.start == b.start && a.track > b.track);
+    };
+    auto indexAt = [&orders](std::uint32_t track, std::uint32_t position) {
+        return orders[track].empty() ? position : orders[track][position];
+    };
+    std::vector<Cursor> heap;
+    heap.reserve(tracks.size());
+    for (std::uint32_t i = 0; i < tracks.size(); i++) {
+        if (!tracks[i].notes.empty()) {
+            heap.emplace_back(Cursor{toTimeline(tracks[i].notes.startOffsets()[indexAt(i, 0)]), i, 0});
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
 
-    // Assume 1 track, due to chosen_track options in the midi parsing
-    auto &t = tracks.front();
-    spdlog::debug("fillTickMap  filling notes for track with #{} notes", t.notes.size());
-    for (auto &n: t.notes) {
-        if (tickMap.find(n.start_offset) == tickMap.end()) {
-            spdlog::debug("fillTickMap  start_offset {} not found, adding", n.start_offset);
-            tickMap[n.start_offset] = std::vector<Note>();
+    // Into the map's own note array, grown by doubling so edits that add notes rarely need a bigger one
+    auto merged = tickMap.takeNotes();
+    if (merged.capacity() < noteCount) {
+        merged.reserve(std::max(noteCount, merged.capacity() * 2));
+    }
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        auto &next = heap.back();
+        auto &starts = tracks[next.track].notes.startOffsets();
+        merged.emplace_back(NoteRef{next.track, indexAt(next.track, next.position)});
+        if (++next.position < starts.size()) {
+            next.start = toTimeline(starts[indexAt(next.track, next.position)]);
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+        else {
+            heap.pop_back();
         }
-        tickMap[n.start_offset].emplace_back(Note(n));
     }
+    tickMap.assignSorted(std::move(merged), [this](const NoteRef &ref) {
+        return tracks[ref.track].notes.startOffsets()[ref.index];
+    });
 }
 
 bool GwidiMidiData::operator==(const GwidiMidiData &rhs) const {
+    if (fingerprint() != rhs.fingerprint()) {
+        return false;
+    }
+
+    // Same fingerprint, nearly always the same data, the full compare rules out a collision
     if (tracks.size() != rhs.tracks.size()) {
         return false;
     }
@@ -74,6 +389,10 @@ bool GwidiMidiData::operator==(const GwidiMidiData &rhs) const {
         return false;
     }
 
+    if (tempoMap != rhs.tempoMap) {
+        return false;
+    }
+
     for (auto i = 0; i < tracks.size(); i++) {
         auto &track = tracks.at(i);
         auto &rhsTrack = rhs.tracks.at(i);
@@ -82,31 +401,77 @@ bool GwidiMidiData::operator==(const GwidiMidiData &rhs) const {
         }
 
         if (track.instrument_name != rhsTrack.instrument_name || track.track_name != rhsTrack.track_name ||
-            track.notes.size() != rhsTrack.notes.size()) {
+            track.notes != rhsTrack.notes) {
             return false;
         }
+    }
+    return true;
+}
+
+std::uint64_t GwidiMidiData::fingerprint() const {
+    auto cached = fingerprintCache.load(std::memory_order_relaxed);
+    if (cached != 0) {
+        return cached;
+    }
+
+    ContentHash hash;
+    hash.addDouble(tempo);
+    hash.addDouble(tempoMicro);
+    hash.addDouble(tempoMap.ticksPerQuarter());
+    hash.addWord(tempoMap.getSegments().size());
+    for (auto &segment: tempoMap.getSegments()) {
+        hash.addWord(std::uint64_t(segment.tick));
+        hash.addDouble(segment.microseconds);
+    }
 
-        for (auto j = 0; j < track.notes.size(); j++) {
-            auto &note = track.notes.at(j);
-            auto &rhsNote = rhsTrack.notes.at(j);
-
-            if (
-                    note.start_offset != rhsNote.start_offset ||
-                    note.duration != rhsNote.duration ||
-                    note.octave != rhsNote.octave ||
-                    note.letter != rhsNote.letter ||
-                    note.instrument != rhsNote.instrument ||
-                    note.track != rhsNote.track ||
-                    note.key != rhsNote.key
-                    ) {
-                return false;
+    // Symbol ids differ between processes, each distinct string is hashed once and its hash stands in for it
+    std::unordered_map<std::uint32_t, std::uint64_t> symbolHashes;
+    auto addSymbols = [&hash, &symbolHashes](const std::pmr::vector<Symbol> &column) {
+        std::uint32_t lastId = 0;
+        std::uint64_t lastHash = ContentHash::ofString(std::string());
+        for (auto &symbol: column) {
+            if (symbol.id() != lastId) {
+                auto it = symbolHashes.find(symbol.id());
+                if (it == symbolHashes.end()) {
+                    it = symbolHashes.emplace(symbol.id(), ContentHash::ofString(symbol.str())).first;
+                }
+                lastId = symbol.id();
+                lastHash = it->second;
             }
+            hash.addWord(lastHash);
+        }
+    };
+
+    hash.addWord(tracks.size());
+    for (auto &t: tracks) {
+        hash.addDouble(t.durationInSeconds);
+        hash.addWord(ContentHash::ofString(t.instrument_name));
+        hash.addWord(ContentHash::ofString(t.track_name));
+        hash.addWord(t.notes.size());
+        for (auto value: t.notes.startOffsets()) {
+            hash.addDouble(value);
+        }
+        for (auto value: t.notes.durations()) {
+            hash.addDouble(value);
+        }
+        for (auto value: t.notes.octaves()) {
+            hash.addWord(std::uint64_t(value));
         }
+        for (auto value: t.notes.tracks()) {
+            hash.addWord(std::uint64_t(value));
+        }
+        addSymbols(t.notes.keys());
+        addSymbols(t.notes.letters());
+        addSymbols(t.notes.instruments());
     }
-    return true;
+
+    // 0 marks the cache as empty
+    auto value = std::max<std::uint64_t>(hash.value(), 1);
+    fingerprintCache.store(value, std::memory_order_relaxed);
+    return value;
 }
 
-double GwidiMidiData::longestTrackDuration() {
+double GwidiMidiData::longestTrackDuration() const {
     double longest{0};
     for (auto &t: tracks) {
         if (t.durationInSeconds > longest) {
@@ -116,58 +481,282 @@ double GwidiMidiData::longestTrackDuration() {
     return longest;
 }
 
+GwidiMidiSnapshot GwidiMidiData::snapshot(GwidiMidiData *data) {
+    // Worked out now, so readers of the snapshot never write to it
+    if (data) {
+        data->fingerprint();
+    }
+    return GwidiMidiSnapshot(data);
+}
+
+GwidiMidiData *GwidiMidiData::edit() const {
+    std::size_t noteCount = 0;
+    for (auto &t: tracks) {
+        noteCount += t.notes.size();
+    }
+    auto copy = new GwidiMidiData(noteCount);
+    copy->tempo = tempo;
+    copy->tempoMicro = tempoMicro;
+    copy->tempoMap = tempoMap;
+    for (auto &t: tracks) {
+        copy->appendTrackCopy(t);
+    }
+    copy->tickMap = tickMap;
+    copy->fingerprintCache.store(fingerprintCache.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return copy;
+}
 
-void GwidiMidiData::writeToFile(const std::string &filename) {
+bool GwidiMidiData::writeToFile(const std::string &filename, GwdEncoding encoding) const {
+    auto buffer = encode(encoding);
     std::ofstream out;
     out.open(filename, std::ios::out | std::ios::binary);
+    if(!out.is_open()) {
+        spdlog::warn("writeToFile failed to open: {}", filename);
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(buffer.data()), std::streamsize(buffer.size()));
+    out.close();
+    if(out.fail()) {
+        spdlog::warn("writeToFile failed to write: {}", filename);
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::uint8_t> GwidiMidiData::encode(GwdEncoding encoding) const {
+    return encoding == GWD_COMPACT ? encodeCompact() : encodeRaw();
+}
+
+std::vector<std::uint8_t> GwidiMidiData::encodeRaw() const {
+    gwd::StringTable strings;
+
+    gwd::Header header;
+    header.track_count = std::uint32_t(tracks.size());
+    header.tempo = tempo;
+    header.tempo_micro = tempoMicro;
+    header.ticks_per_quarter = tempoMap.ticksPerQuarter();
+    header.tempo_segment_count = std::uint32_t(tempoMap.getSegments().size());
 
-    size_t track_count = tracks.size();
-    out.write(reinterpret_cast<const char *>(&track_count), sizeof(size_t));
-    out.write(reinterpret_cast<const char *>(&tempo), sizeof(double));
-    out.write(reinterpret_cast<const char *>(&tempoMicro), sizeof(double));
+    std::vector<std::uint32_t> trackNames;
+    std::vector<std::uint32_t> keys;
+    std::vector<std::uint32_t> letters;
+    std::vector<std::uint32_t> instruments;
     for (auto &t: tracks) {
-        out.write(reinterpret_cast<const char *>(&(t.durationInSeconds)), sizeof(double));
+        trackNames.emplace_back(strings.id(t.instrument_name));
+        trackNames.emplace_back(strings.id(t.track_name));
+        header.note_count += t.notes.size();
+    }
+    keys.reserve(header.note_count);
+    letters.reserve(header.note_count);
+    instruments.reserve(header.note_count);
+    for (auto &t: tracks) {
+        for (auto &key: t.notes.keys()) {
+            keys.emplace_back(strings.id(key));
+        }
+        for (auto &letter: t.notes.letters()) {
+            letters.emplace_back(strings.id(letter));
+        }
+        for (auto &instrument: t.notes.instruments()) {
+            instruments.emplace_back(strings.id(instrument));
+        }
+    }
+    header.string_count = std::uint32_t(strings.strings().size());
+
+    std::size_t stringBytes = 0;
+    for (auto str: strings.strings()) {
+        stringBytes += str.size();
+    }
+    auto sections = gwd::sections(header);
+    header.body_size = sections.string_bytes + stringBytes - gwd::s_headerSize;
+
+    // The whole file is laid out in one buffer, writeToFile then writes it at once
+    std::vector<std::uint8_t> buffer(gwd::s_headerSize + header.body_size);
+    auto data = buffer.data();
+    std::size_t first = 0;
+    for (std::size_t i = 0; i < tracks.size(); i++) {
+        auto &t = tracks[i];
+        auto record = data + sections.tracks + i * gwd::s_trackRecordSize;
+        gwd::storeLE<double>(record, t.durationInSeconds);
+        gwd::storeLE<std::uint64_t>(record + 8, first);
+        gwd::storeLE<std::uint32_t>(record + 16, std::uint32_t(t.notes.size()));
+        gwd::storeLE<std::uint32_t>(record + 20, trackNames[i * 2]);
+        gwd::storeLE<std::uint32_t>(record + 24, trackNames[i * 2 + 1]);
+        auto &starts = t.notes.startOffsets();
+        gwd::storeLE<std::uint32_t>(record + 28, std::is_sorted(starts.begin(), starts.end()) ? gwd::s_trackSortedByStart : 0);
+
+        auto count = t.notes.size();
+        gwd::storeColumnLE(data + sections.starts + first * sizeof(double), count, t.notes.startOffsets().data());
+        gwd::storeColumnLE(data + sections.durations + first * sizeof(double), count, t.notes.durations().data());
+        gwd::storeColumnLE(data + sections.track_ids + first * sizeof(std::int32_t), count, t.notes.tracks().data());
+        gwd::storeColumnLE(data + sections.octaves + first * sizeof(std::int16_t), count, t.notes.octaves().data());
+        first += count;
+    }
+    gwd::storeColumnLE(data + sections.keys, keys.size(), keys.data());
+    gwd::storeColumnLE(data + sections.letters, letters.size(), letters.data());
+    gwd::storeColumnLE(data + sections.instruments, instruments.size(), instruments.data());
+
+    auto segment = data + sections.tempo;
+    for (auto &s: tempoMap.getSegments()) {
+        gwd::storeLE<std::int64_t>(segment, s.tick);
+        gwd::storeLE<double>(segment + 8, s.microseconds);
+        segment += gwd::s_tempoSegmentSize;
+    }
 
-        size_t instrument_name_size = t.instrument_name.size();
-        out.write(reinterpret_cast<const char *>(&instrument_name_size), sizeof(size_t));
-        out.write(reinterpret_cast<const char *>(&t.instrument_name[0]), sizeof(char) * instrument_name_size);
+    std::uint32_t offset = 0;
+    auto &table = strings.strings();
+    for (std::size_t i = 0; i < table.size(); i++) {
+        gwd::storeLE<std::uint32_t>(data + sections.strings + i * sizeof(std::uint32_t), offset);
+        std::memcpy(data + sections.string_bytes + offset, table[i].data(), table[i].size());
+        offset += std::uint32_t(table[i].size());
+    }
+    gwd::storeLE<std::uint32_t>(data + sections.strings + table.size() * sizeof(std::uint32_t), offset);
 
-        size_t track_name_size = t.track_name.size();
-        out.write(reinterpret_cast<const char *>(&track_name_size), sizeof(size_t));
-        out.write(reinterpret_cast<const char *>(&t.track_name[0]), sizeof(char) * track_name_size);
+    gwd::writeHeader(data, header);
+    header.crc = gwd::checksum(data, header.body_size);
+    gwd::writeHeader(data, header);
+    return buffer;
+}
 
-        size_t note_count = t.notes.size();
-        out.write(reinterpret_cast<const char *>(&note_count), sizeof(size_t));
+GwidiMidiSnapshot GwidiMidiData::readSnapshot(const std::string &filename) {
+    return snapshot(readFromFile(filename));
+}
 
-        for (auto &n: t.notes) {
-            out.write(reinterpret_cast<const char *>(&(n.start_offset)), sizeof(double));
-            out.write(reinterpret_cast<const char *>(&(n.duration)), sizeof(double));
-            out.write(reinterpret_cast<const char *>(&(n.octave)), sizeof(int));
+GwidiMidiData *GwidiMidiData::readFromFile(const std::string &filename) {
+    std::ifstream in;
+    in.open(filename, std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+        spdlog::warn("readFromFile failed to open: {}", filename);
+        return nullptr;
+    }
 
-            size_t letter_size = n.letter.size();
-            out.write(reinterpret_cast<const char *>(&letter_size), sizeof(size_t));
-            out.write(reinterpret_cast<const char *>(&(n.letter[0])), sizeof(char) * letter_size);
+    char magic[sizeof(gwd::s_magic)]{};
+    in.read(magic, sizeof(magic));
+    if (in.gcount() != sizeof(magic) || std::memcmp(magic, gwd::s_magic, sizeof(magic)) != 0) {
+        // No magic, a v1 file
+        in.clear();
+        in.seekg(0);
+        return readV1(in);
+    }
 
-            size_t instrument_size = n.instrument.size();
-            out.write(reinterpret_cast<const char *>(&instrument_size), sizeof(size_t));
-            out.write(reinterpret_cast<const char *>(&(n.instrument[0])), sizeof(char) * instrument_size);
+    // One read for the whole file
+    in.seekg(0, std::ios::end);
+    auto end = in.tellg();
+    if (!in.good() || end < 0) {
+        spdlog::warn("readFromFile failed to find the size of: {}", filename);
+        return nullptr;
+    }
+    std::vector<std::uint8_t> bytes(static_cast<std::size_t>(end));
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(bytes.data()), std::streamsize(bytes.size()));
+    if (in.gcount() != std::streamsize(bytes.size())) {
+        spdlog::warn("readFromFile failed to read: {}", filename);
+        return nullptr;
+    }
+    auto outData = readFromMemory(bytes.data(), bytes.size());
+    if (!outData) {
+        spdlog::warn("readFromFile not a valid .gwd file: {}", filename);
+    }
+    return outData;
+}
 
-            out.write(reinterpret_cast<const char *>(&(n.track)), sizeof(int));
+GwidiMidiData *GwidiMidiData::readFromMemory(const std::uint8_t *data, std::size_t size) {
+    gwd::Header header;
+    if (!gwd::readHeader(data, size, header)) {
+        return nullptr;
+    }
+    if (gwd::checksum(data, header.body_size) != header.crc) {
+        spdlog::warn("readFromMemory .gwd checksum does not match");
+        return nullptr;
+    }
+    if (header.version == gwd::s_compactVersion) {
+        return readCompact(data, size);
+    }
+    auto sections = gwd::sections(header);
+    auto stringBytesSize = gwd::s_headerSize + header.body_size - sections.string_bytes;
+
+    // Track names are copied straight out, only strings the note columns use get interned, once each
+    std::vector<std::string_view> strings(header.string_count);
+    for (std::size_t i = 0; i < strings.size(); i++) {
+        auto begin = gwd::loadLE<std::uint32_t>(data + sections.strings + i * sizeof(std::uint32_t));
+        auto end = gwd::loadLE<std::uint32_t>(data + sections.strings + (i + 1) * sizeof(std::uint32_t));
+        if (begin > end || end > stringBytesSize) {
+            return nullptr;
+        }
+        strings[i] = std::string_view(reinterpret_cast<const char *>(data + sections.string_bytes + begin), end - begin);
+    }
+    std::vector<Symbol> symbols(strings.size());
+    std::vector<bool> interned(strings.size(), false);
+    auto symbolColumn = [&strings, &symbols, &interned, data](std::size_t offset, std::size_t count, std::pmr::vector<Symbol> &out) {
+        out.resize(count);
+        for (std::size_t i = 0; i < count; i++) {
+            auto id = gwd::loadLE<std::uint32_t>(data + offset + i * sizeof(std::uint32_t));
+            if (id >= strings.size()) {
+                out[i] = Symbol();
+                continue;
+            }
+            if (!interned[id]) {
+                symbols[id] = Symbol(strings[id]);
+                interned[id] = true;
+            }
+            out[i] = symbols[id];
+        }
+    };
+
+    auto outData = new GwidiMidiData(std::size_t(header.note_count));
+    outData->tempo = header.tempo;
+    outData->tempoMicro = header.tempo_micro;
+    for (std::size_t i = 0; i < header.track_count; i++) {
+        auto record = data + sections.tracks + i * gwd::s_trackRecordSize;
+        auto first = gwd::loadLE<std::uint64_t>(record + 8);
+        std::size_t count = gwd::loadLE<std::uint32_t>(record + 16);
+        auto instrumentName = gwd::loadLE<std::uint32_t>(record + 20);
+        auto trackName = gwd::loadLE<std::uint32_t>(record + 24);
+        if (first > header.note_count || count > header.note_count - first ||
+            instrumentName >= strings.size() || trackName >= strings.size()) {
+            delete outData;
+            return nullptr;
+        }
+        outData->tracks.emplace_back(Track{
+                NoteColumns(outData->getArena()),
+                std::string(strings[instrumentName]),
+                std::string(strings[trackName]),
+                gwd::loadLE<double>(record)
+        });
+
+        // Straight into the columns, no Note in between
+        auto &notes = outData->tracks.back().notes;
+        notes.m_startOffsets.resize(count);
+        gwd::loadColumnLE(data + sections.starts + first * sizeof(double), count, notes.m_startOffsets.data());
+        notes.m_durations.resize(count);
+        gwd::loadColumnLE(data + sections.durations + first * sizeof(double), count, notes.m_durations.data());
+        notes.m_tracks.resize(count);
+        gwd::loadColumnLE(data + sections.track_ids + first * sizeof(std::int32_t), count, notes.m_tracks.data());
+        notes.m_octaves.resize(count);
+        gwd::loadColumnLE(data + sections.octaves + first * sizeof(std::int16_t), count, notes.m_octaves.data());
+        symbolColumn(sections.keys + first * sizeof(std::uint32_t), count, notes.m_keys);
+        symbolColumn(sections.letters + first * sizeof(std::uint32_t), count, notes.m_letters);
+        symbolColumn(sections.instruments + first * sizeof(std::uint32_t), count, notes.m_instruments);
+    }
 
-            size_t key_size = n.key.size();
-            out.write(reinterpret_cast<const char *>(&key_size), sizeof(size_t));
-            out.write(reinterpret_cast<const char *>(&(n.key[0])), sizeof(char) * key_size);
+    if (header.tempo_segment_count > 0) {
+        std::vector<TempoChange> changes(header.tempo_segment_count);
+        for (std::size_t i = 0; i < changes.size(); i++) {
+            auto segment = data + sections.tempo + i * gwd::s_tempoSegmentSize;
+            changes[i].tick = gwd::loadLE<std::int64_t>(segment);
+            changes[i].microseconds = gwd::loadLE<double>(segment + 8);
         }
+        outData->tempoMap = TempoMap(header.ticks_per_quarter, changes);
     }
-    out.close();
+
+    if (!outData->tracks.empty()) {
+        outData->fillTickMap();
+    }
+    return outData;
 }
 
-GwidiMidiData *GwidiMidiData::readFromFile(const std::string &filename) {
+// v1 files: host-endian, size_t length prefixed, one field at a time
+GwidiMidiData *GwidiMidiData::readV1(std::istream &in) {
     auto outData = new GwidiMidiData();
-    std::ifstream in;
-    in.open(filename, std::ios::in | std::ios::binary);
-
-    std::vector<unsigned char> inData(in.tellg());
 
     size_t track_count;
     in.read(reinterpret_cast<char *>(&track_count), sizeof(size_t));
@@ -181,7 +770,7 @@ GwidiMidiData *GwidiMidiData::readFromFile(const std::string &filename) {
     outData->tempo = tempo;
     outData->tempoMicro = tempoMicro;
 
-    for (auto i = 0; i < track_count; i++) {
+    for (std::size_t i = 0; i < track_count && in; i++) {
         double trackDurationInSeconds;
         in.read(reinterpret_cast<char *>(&trackDurationInSeconds), sizeof(double));
 
@@ -200,8 +789,9 @@ GwidiMidiData *GwidiMidiData::readFromFile(const std::string &filename) {
         size_t notes_size;
         in.read(reinterpret_cast<char *>(&notes_size), sizeof(size_t));
 
-        std::vector<Note> notes;
-        for (auto j = 0; j < notes_size; j++) {
+        outData->addTrack(instrument_name, track_name, {}, trackDurationInSeconds);
+        auto &notes = outData->tracks.back().notes;
+        for (std::size_t j = 0; j < notes_size && in; j++) {
             double start_offset;
             in.read(reinterpret_cast<char *>(&start_offset), sizeof(double));
 
@@ -242,11 +832,26 @@ GwidiMidiData *GwidiMidiData::readFromFile(const std::string &filename) {
                     key
             });
         }
-        outData->addTrack(instrument_name, track_name, notes, trackDurationInSeconds);
     }
 
-    in.close();
-    outData->fillTickMap();
+    // Files written before the tempo map was stored end here
+    double ticks_per_quarter;
+    size_t segment_count;
+    if (in.read(reinterpret_cast<char *>(&ticks_per_quarter), sizeof(double)) &&
+        in.read(reinterpret_cast<char *>(&segment_count), sizeof(size_t)) && segment_count > 0) {
+        std::vector<TempoChange> changes;
+        for (std::size_t i = 0; i < segment_count && in; i++) {
+            TempoChange change;
+            in.read(reinterpret_cast<char *>(&change.tick), sizeof(std::int64_t));
+            in.read(reinterpret_cast<char *>(&change.microseconds), sizeof(double));
+            changes.emplace_back(change);
+        }
+        outData->tempoMap = TempoMap(ticks_per_quarter, changes);
+    }
+
+    if (!outData->tracks.empty()) {
+        outData->fillTickMap();
+    }
     return outData;
 }
 
@@ -0,0 +1,94 @@
+#include "GwidiMidiStream.h"
+#include "spdlog/spdlog.h"
+
+namespace gwidi::data::midi {
+
+void GwidiMidiStream::append(const std::vector<Note> &notes, double watermark) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Chunks come in start order, so this only ever appends to the flat map
+        for(auto &n : notes) {
+            m_tickMap.insert(n.start_offset, std::uint32_t(m_notes.size()));
+            m_notes.emplace_back(n);
+        }
+        if(watermark > m_watermark) {
+            m_watermark = watermark;
+        }
+        spdlog::debug("GwidiMidiStream::append {} notes, watermark: {}", notes.size(), m_watermark);
+    }
+    m_cv.notify_all();
+}
+
+void GwidiMidiStream::finish(double durationInSeconds) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_duration = durationInSeconds;
+        m_watermark = std::numeric_limits<double>::infinity();
+        m_finished = true;
+    }
+    m_cv.notify_all();
+}
+
+double GwidiMidiStream::watermark() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_watermark;
+}
+
+bool GwidiMidiStream::finished() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_finished;
+}
+
+double GwidiMidiStream::duration() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_duration;
+}
+
+void GwidiMidiStream::waitForWatermark(double time) const {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this, time]() {
+        return m_finished || m_watermark >= time;
+    });
+}
+
+void GwidiMidiStream::waitFinished() const {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]() {
+        return m_finished;
+    });
+}
+
+double GwidiMidiStream::tickMapFloorKey(double time) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto index = m_tickMap.floorIndex(time);
+    return index == FlatTickMap<std::uint32_t>::npos ? -1.0 : m_tickMap.keyAt(index);
+}
+
+std::vector<Note> GwidiMidiStream::notesAt(double key) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Note> notes;
+    for(auto index : m_tickMap.notesAt(key)) {
+        notes.emplace_back(m_notes.at(index));
+    }
+    return notes;
+}
+
+double GwidiMidiStream::floorNotes(double time, std::vector<Note> &out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out.clear();
+    auto index = m_tickMap.floorIndex(time);
+    if(index == FlatTickMap<std::uint32_t>::npos) {
+        return -1.0;
+    }
+    for(auto i : m_tickMap.notesAtIndex(index)) {
+        out.emplace_back(m_notes.at(i));
+    }
+    return m_tickMap.keyAt(index);
+}
+
+std::size_t GwidiMidiStream::noteCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tickMap.noteCount();
+}
+
+}
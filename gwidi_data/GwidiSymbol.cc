@@ -0,0 +1,65 @@
+#include "GwidiSymbol.h"
+#include "spdlog/spdlog.h"
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace gwidi::data {
+
+namespace {
+struct SymbolTable {
+    std::shared_mutex mutex;
+    std::deque<std::string> strings{""};     // deque, so references handed out by str() survive growth
+    std::unordered_map<std::string_view, std::uint32_t> ids{{strings.front(), 0}};
+
+    static SymbolTable &getInstance() {
+        static SymbolTable instance;
+        return instance;
+    }
+
+    std::uint32_t intern(std::string_view value) {
+        {
+            std::shared_lock lock(mutex);
+            auto it = ids.find(value);
+            if(it != ids.end()) {
+                return it->second;
+            }
+        }
+        std::unique_lock lock(mutex);
+        // Someone else may have added it between the locks
+        auto it = ids.find(value);
+        if(it != ids.end()) {
+            return it->second;
+        }
+        auto id = std::uint32_t(strings.size());
+        strings.emplace_back(value);
+        ids.emplace(strings.back(), id);
+        if(strings.size() == Symbol::s_warnCount) {
+            spdlog::warn("Symbol table reached {} strings, it never shrinks", Symbol::s_warnCount);
+        }
+        return id;
+    }
+};
+}
+
+Symbol::Symbol(const std::string &value) : m_id{SymbolTable::getInstance().intern(value)} {}
+
+Symbol::Symbol(const char *value) : m_id{value ? SymbolTable::getInstance().intern(value) : 0} {}
+
+Symbol::Symbol(std::string_view value) : m_id{SymbolTable::getInstance().intern(value)} {}
+
+const std::string &Symbol::str() const {
+    auto &table = SymbolTable::getInstance();
+    std::shared_lock lock(table.mutex);
+    return table.strings[m_id];
+}
+
+std::size_t Symbol::count() {
+    auto &table = SymbolTable::getInstance();
+    std::shared_lock lock(table.mutex);
+    return table.strings.size();
+}
+
+}
@@ -0,0 +1,79 @@
+#include "GwidiTempoMap.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace gwidi::data::midi {
+
+namespace {
+constexpr double s_defaultTempoMicro = 500000.0;   // 120 bpm until told otherwise
+}
+
+TempoMap::TempoMap(double ticksPerQuarter, const std::vector<TempoChange> &changes) {
+    m_ticksPerQuarter = ticksPerQuarter > 0 ? ticksPerQuarter : 1;
+    m_divisor = 1000000.0 * m_ticksPerQuarter;
+
+    m_segments.emplace_back(Segment{0, 0.0, 0.0, s_defaultTempoMicro});
+    for(auto &change : changes) {
+        // The decoders already drop these, this also covers maps read back from a damaged .gwd
+        if(!(change.microseconds > 0)) {
+            continue;
+        }
+        auto &last = m_segments.back();
+        // Several changes on one tick, the last one wins
+        if(change.tick == last.tick) {
+            last.microseconds = change.microseconds;
+            continue;
+        }
+        auto seconds = last.seconds + double(change.tick - last.tick) * last.microseconds / m_divisor;
+        auto beats = double(change.tick) / m_ticksPerQuarter;
+        m_segments.emplace_back(Segment{change.tick, seconds, beats, change.microseconds});
+    }
+}
+
+TempoMap TempoMap::fromSmpte(int framesPerSecond, int ticksPerFrame) {
+    // Tempo events don't apply, a constant 120 bpm over (ticks per second / 2) ticks per quarter gives the same seconds
+    return TempoMap(framesPerSecond * ticksPerFrame / 2.0, {});
+}
+
+// Rounded once per conversion rather than accumulated per event
+double TempoMap::secondsAtTick(std::int64_t tick) const {
+    if(m_segments.empty()) {
+        return 0.0;
+    }
+    auto it = std::upper_bound(m_segments.begin(), m_segments.end(), tick, [](std::int64_t t, const Segment &s) {
+        return t < s.tick;
+    });
+    auto &segment = it == m_segments.begin() ? *it : *std::prev(it);
+    return segment.seconds + double(tick - segment.tick) * segment.microseconds / m_divisor;
+}
+
+double TempoMap::beatsAtSeconds(double seconds) const {
+    if(m_segments.empty()) {
+        return 0.0;
+    }
+    auto it = std::upper_bound(m_segments.begin(), m_segments.end(), seconds, [](double s, const Segment &segment) {
+        return s < segment.seconds;
+    });
+    auto &segment = it == m_segments.begin() ? *it : *std::prev(it);
+    return segment.beats + (seconds - segment.seconds) * 1000000.0 / segment.microseconds;
+}
+
+int TempoMap::gridIndexAtSeconds(double seconds, int divisionsPerQuarter) const {
+    // Small tolerance so notes sitting on a grid line (give or take float error) don't round up to the next one
+    return int(ceil(beatsAtSeconds(seconds) * divisionsPerQuarter - 0.000001));
+}
+
+bool TempoMap::operator==(const TempoMap &rhs) const {
+    if(m_ticksPerQuarter != rhs.m_ticksPerQuarter || m_segments.size() != rhs.m_segments.size()) {
+        return false;
+    }
+    for(std::size_t i = 0; i < m_segments.size(); i++) {
+        if(m_segments[i].tick != rhs.m_segments[i].tick || m_segments[i].microseconds != rhs.m_segments[i].microseconds) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
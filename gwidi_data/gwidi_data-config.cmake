@@ -11,6 +11,13 @@ target_sources(gwidi_data PUBLIC
         ${CMAKE_CURRENT_LIST_DIR}/GwidiMidiData.cc
         ${CMAKE_CURRENT_LIST_DIR}/GwidiGuiData.cc
         ${CMAKE_CURRENT_LIST_DIR}/GwidiDataConverter.cc
+        ${CMAKE_CURRENT_LIST_DIR}/GwidiMappedFile.cc
+        ${CMAKE_CURRENT_LIST_DIR}/GwidiTempoMap.cc
+        ${CMAKE_CURRENT_LIST_DIR}/GwidiMidiStream.cc
+        ${CMAKE_CURRENT_LIST_DIR}/GwidiSymbol.cc
+        ${CMAKE_CURRENT_LIST_DIR}/GwidiGwdFormat.cc
+        ${CMAKE_CURRENT_LIST_DIR}/GwidiGwdCompact.cc
+        ${CMAKE_CURRENT_LIST_DIR}/GwidiMappedMidiData.cc
 )
 target_include_directories(gwidi_data PUBLIC
         ${DATA_HDRS}
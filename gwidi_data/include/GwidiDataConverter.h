@@ -10,7 +10,11 @@ class GwidiDataConverter {
 public:
     static GwidiDataConverter& getInstance();
 
-    gui::GwidiGuiData* midiToGui(midi::GwidiMidiData* data);
+    gui::GwidiGuiData* midiToGui(const midi::GwidiMidiData* data);
+    gui::GwidiGuiData* midiToGui(const midi::GwidiMidiSnapshot& data);
+    // The song the gui data describes, shared read-only like every other midi source
+    midi::GwidiMidiSnapshot guiToMidiSnapshot(gui::GwidiGuiData* data);
+    // Deprecated, the caller owns the returned data and has to delete it, use guiToMidiSnapshot
     midi::GwidiMidiData* guiToMidi(gui::GwidiGuiData* data);
 private:
     GwidiDataConverter() = default;
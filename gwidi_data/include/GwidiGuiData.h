@@ -4,22 +4,24 @@
 #include <vector>
 #include <string>
 #include <map>
+#include "GwidiSymbol.h"
+#include "GwidiTickMap.h"
 
 namespace gwidi::data::gui {
 
 struct Note {
-    std::vector<std::string> letters;
+    std::vector<Symbol> letters;
     int measure{0};
     int octave{0};
     int time{0};
-    std::string key{};
+    Symbol key{};
     bool activated{false};
 
     std::size_t hash() const {
         std::size_t h1 = std::hash<double>{}(time);
         std::size_t h2 = std::hash<double>{}(measure);
         std::size_t h3 = std::hash<int>{}(octave);
-        std::size_t h4 = std::hash<std::string>{}(key);
+        std::size_t h4 = std::hash<Symbol>{}(key);
         return h1 ^ (h2 << 1) ^ (h3 << 2) ^ (h4 << 3);
     }
 };
@@ -39,7 +41,7 @@ class GwidiGuiData {
 public:
     // key -> time in offset
     // value -> list of notes that are activated for that time
-    using TickMapType = std::map<double, std::vector<Note>>;
+    using TickMapType = FlatTickMap<Note>;
 
     GwidiGuiData() : GwidiGuiData("default") {}
     explicit GwidiGuiData(const std::string& instrument);
@@ -48,7 +50,7 @@ public:
     void toggleNote(Note* note);
 
     double trackDuration();
-    double timeIndexToTickOffset(Note* note) const;
+    double timeIndexToTickOffset(const Note* note) const;
 
     inline std::vector<Measure>& getMeasures() {
         return measures;
@@ -0,0 +1,265 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDIGWDFORMAT_H
+#define GWIDI_MIDI_PARSER_GWIDIGWDFORMAT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "GwidiSymbol.h"
+
+namespace gwidi::data::midi::gwd {
+
+// Layout of a v2 .gwd file, every number little-endian, every section starts on an 8 byte boundary
+//   Header            see Header below, s_headerSize bytes
+//   Track records     track_count x {f64 duration, u64 first note, u32 note count, u32 instrument name, u32 track name, u32 flags}
+//   Note columns      note_count x f64 start, then f64 duration, u32 key, u32 letter, u32 instrument, i32 track, i16 octave
+//   Tempo segments    tempo_segment_count x {i64 tick, f64 microseconds}
+//   String table      (string_count + 1) x u32 offsets into the bytes that follow, then the bytes
+// Notes of every track are in one set of columns, a track's notes are [first note, first note + note count)
+// Keys, letters and names are ids into the string table, string 0 is always the empty string
+// The crc (CRC-32) covers the header, with the crc field read as 0, and everything after it
+// v1 files (no magic, host-endian size_t prefixed fields) are still read by GwidiMidiData::readFromFile
+//
+// Compact files (version 3) share the header, with quantum_ns set, but the body is one stream of LEB128 varints
+//   String table      string_count x {varint length, bytes}
+//   Tempo segments    tempo_segment_count x {varint zigzag tick delta, f64 microseconds}
+//   Tracks            track_count x {f64 duration, varint instrument name, varint track name, varint note count, columns}
+//   Columns           starts: one zigzag varint per note, the change in start from the previous note
+//                     durations, keys, letters, instruments, tracks, octaves: runs of {varint value, varint run length}
+// Starts and durations are counted in quanta and come back rounded to the nearest one, everything else is exact
+// Compact files can't be mapped, GwidiMidiData::readFromFile / readFromMemory decode them
+
+constexpr char s_magic[4] = {'G', 'W', 'D', 'F'};
+constexpr std::uint32_t s_version = 2;
+constexpr std::uint32_t s_compactVersion = 3;
+// 1 microsecond, far below what playback can tell apart
+constexpr std::uint32_t s_compactQuantumNs = 1000;
+// Smallest a compact tempo segment {varint, f64} and track {f64, 3 varints} can be, bounds the header counts
+constexpr std::size_t s_compactMinTempoSegmentSize = 9;
+constexpr std::size_t s_compactMinTrackSize = 11;
+constexpr std::size_t s_headerSize = 72;
+constexpr std::size_t s_trackRecordSize = 32;
+constexpr std::size_t s_tempoSegmentSize = 16;
+
+// Track record flags
+// The track's start column is in order, a binary search over it finds the notes playing at any time
+constexpr std::uint32_t s_trackSortedByStart = 1u << 0;
+
+struct Header {
+    std::uint32_t version{s_version};
+    std::uint32_t crc{0};
+    std::uint64_t body_size{0};
+    std::uint64_t note_count{0};
+    std::uint32_t track_count{0};
+    std::uint32_t string_count{0};
+    std::uint32_t tempo_segment_count{0};
+    double tempo{0.0};
+    double tempo_micro{0.0};
+    double ticks_per_quarter{0.0};
+    std::uint32_t quantum_ns{0};    // compact files only
+};
+
+// Byte offsets (from the start of the file) of every section, all derived from the header counts
+struct Sections {
+    std::size_t tracks{0};
+    std::size_t starts{0};
+    std::size_t durations{0};
+    std::size_t keys{0};
+    std::size_t letters{0};
+    std::size_t instruments{0};
+    std::size_t track_ids{0};
+    std::size_t octaves{0};
+    std::size_t tempo{0};
+    std::size_t strings{0};     // the offset table, string bytes follow it
+    std::size_t string_bytes{0};
+};
+
+inline std::size_t align8(std::size_t offset) {
+    return (offset + 7) & ~std::size_t(7);
+}
+
+Sections sections(const Header &header);
+
+// Only checks the magic, the file may still be truncated or corrupt
+bool isGwd(const std::uint8_t *data, std::size_t size);
+// Magic, version and section sizes, false when the data can't hold what the header describes
+// Compact bodies have no fixed sections, only their total size is checked
+bool readHeader(const std::uint8_t *data, std::size_t size, Header &out);
+void writeHeader(std::uint8_t *out, const Header &header);
+
+// Pass the previous result as crc to continue over more data
+std::uint32_t crc32(const std::uint8_t *data, std::size_t size, std::uint32_t crc = 0);
+// The crc a file's header should hold, over its header and body_size bytes of body
+std::uint32_t checksum(const std::uint8_t *file, std::uint64_t bodySize);
+
+// File local string ids in first-seen order, 0 is the empty string
+class StringTable {
+public:
+    StringTable() : m_strings{std::string_view()}, m_ids{{std::string_view(), 0}} {}
+
+    // Keyed by the string itself, track names go in as-is and never touch the Symbol table
+    // The views must outlive the table, it only lives for one encode
+    std::uint32_t id(std::string_view value) {
+        auto it = m_ids.find(value);
+        if(it != m_ids.end()) {
+            return it->second;
+        }
+        auto id = std::uint32_t(m_strings.size());
+        m_strings.emplace_back(value);
+        m_ids.emplace(value, id);
+        return id;
+    }
+    inline std::uint32_t id(const std::string &value) {
+        return id(std::string_view(value));
+    }
+    inline std::uint32_t id(const Symbol &symbol) {
+        return id(std::string_view(symbol.str()));
+    }
+    inline const std::vector<std::string_view> &strings() const {
+        return m_strings;
+    }
+
+private:
+    std::vector<std::string_view> m_strings;
+    std::unordered_map<std::string_view, std::uint32_t> m_ids;
+};
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr bool s_hostLittleEndian = false;
+#else
+constexpr bool s_hostLittleEndian = true;
+#endif
+
+template<typename T>
+inline T loadLE(const std::uint8_t *p) {
+    T value;
+    if constexpr (s_hostLittleEndian) {
+        std::memcpy(&value, p, sizeof(T));
+    }
+    else {
+        std::uint8_t bytes[sizeof(T)];
+        for(std::size_t i = 0; i < sizeof(T); i++) {
+            bytes[i] = p[sizeof(T) - 1 - i];
+        }
+        std::memcpy(&value, bytes, sizeof(T));
+    }
+    return value;
+}
+
+template<typename T>
+inline void storeLE(std::uint8_t *p, T value) {
+    if constexpr (s_hostLittleEndian) {
+        std::memcpy(p, &value, sizeof(T));
+    }
+    else {
+        std::uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for(std::size_t i = 0; i < sizeof(T); i++) {
+            p[i] = bytes[sizeof(T) - 1 - i];
+        }
+    }
+}
+
+// Whole columns at once, a plain copy on little-endian hosts
+template<typename T>
+inline void loadColumnLE(const std::uint8_t *p, std::size_t count, T *out) {
+    if constexpr (s_hostLittleEndian) {
+        std::memcpy(out, p, count * sizeof(T));
+    }
+    else {
+        for(std::size_t i = 0; i < count; i++) {
+            out[i] = loadLE<T>(p + i * sizeof(T));
+        }
+    }
+}
+
+template<typename T>
+inline void storeColumnLE(std::uint8_t *p, std::size_t count, const T *values) {
+    if constexpr (s_hostLittleEndian) {
+        std::memcpy(p, values, count * sizeof(T));
+    }
+    else {
+        for(std::size_t i = 0; i < count; i++) {
+            storeLE<T>(p + i * sizeof(T), values[i]);
+        }
+    }
+}
+
+// Compact body primitives
+inline void putVarint(std::vector<std::uint8_t> &out, std::uint64_t value) {
+    while(value >= 0x80) {
+        out.push_back(std::uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(std::uint8_t(value));
+}
+
+// Small magnitudes of either sign stay small, so they take few varint bytes
+inline std::uint64_t zigzag(std::int64_t value) {
+    return (std::uint64_t(value) << 1) ^ std::uint64_t(value >> 63);
+}
+inline std::int64_t unzigzag(std::uint64_t value) {
+    return std::int64_t(value >> 1) ^ -std::int64_t(value & 1);
+}
+
+template<typename T>
+inline void putFixed(std::vector<std::uint8_t> &out, T value) {
+    auto size = out.size();
+    out.resize(size + sizeof(T));
+    storeLE<T>(out.data() + size, value);
+}
+
+// Bounds checked reads over a compact body, every read fails once the data runs out
+class ByteReader {
+public:
+    ByteReader(const std::uint8_t *data, std::size_t size) : m_pos{data}, m_end{data + size} {}
+
+    inline bool varint(std::uint64_t &out) {
+        // Most values fit in one byte
+        if(m_pos < m_end && *m_pos < 0x80) {
+            out = *m_pos++;
+            return true;
+        }
+        std::uint64_t value = 0;
+        for(unsigned shift = 0; shift < 64 && m_pos < m_end; shift += 7) {
+            auto byte = *m_pos++;
+            value |= std::uint64_t(byte & 0x7F) << shift;
+            if(!(byte & 0x80)) {
+                out = value;
+                return true;
+            }
+        }
+        return false;
+    }
+    template<typename T>
+    inline bool fixed(T &out) {
+        if(std::size_t(m_end - m_pos) < sizeof(T)) {
+            return false;
+        }
+        out = loadLE<T>(m_pos);
+        m_pos += sizeof(T);
+        return true;
+    }
+    inline bool bytes(std::size_t count, const std::uint8_t *&out) {
+        if(std::size_t(m_end - m_pos) < count) {
+            return false;
+        }
+        out = m_pos;
+        m_pos += count;
+        return true;
+    }
+    inline bool atEnd() const {
+        return m_pos == m_end;
+    }
+
+private:
+    const std::uint8_t *m_pos;
+    const std::uint8_t *m_end;
+};
+
+}
+
+#endif //GWIDI_MIDI_PARSER_GWIDIGWDFORMAT_H
@@ -0,0 +1,47 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDIMAPPEDFILE_H
+#define GWIDI_MIDI_PARSER_GWIDIMAPPEDFILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gwidi::data {
+
+// Read-only view of a whole file, memory mapped where the platform allows it
+// Falls back to reading the file into memory otherwise
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile& operator=(MappedFile &&other) noexcept;
+
+    inline bool isOpen() const {
+        return m_data != nullptr;
+    }
+
+    inline const std::uint8_t* data() const {
+        return m_data;
+    }
+
+    inline std::size_t size() const {
+        return m_size;
+    }
+
+private:
+    void close();
+
+    const std::uint8_t* m_data{nullptr};
+    std::size_t m_size{0};
+    bool m_mapped{false};
+    std::vector<std::uint8_t> m_fallback;
+};
+
+}
+
+#endif //GWIDI_MIDI_PARSER_GWIDIMAPPEDFILE_H
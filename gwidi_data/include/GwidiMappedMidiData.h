@@ -0,0 +1,143 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDIMAPPEDMIDIDATA_H
+#define GWIDI_MIDI_PARSER_GWIDIMAPPEDMIDIDATA_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "GwidiMappedFile.h"
+#include "GwidiGwdFormat.h"
+#include "GwidiMidiData.h"
+#include "GwidiTickMap.h"
+
+namespace gwidi::data::midi {
+
+// One column of a mapped .gwd file, values are read straight out of the mapped bytes
+template<typename T>
+class MappedColumn {
+public:
+    MappedColumn() = default;
+    MappedColumn(const std::uint8_t *data, std::size_t count) : m_data{data}, m_count{count} {}
+
+    inline T operator[](std::size_t index) const {
+        return gwd::loadLE<T>(m_data + index * sizeof(T));
+    }
+    inline std::size_t size() const {
+        return m_count;
+    }
+
+private:
+    const std::uint8_t *m_data{nullptr};
+    std::size_t m_count{0};
+};
+
+class GwidiMappedMidiData;
+
+class MappedTrack {
+public:
+    MappedTrack(const GwidiMappedMidiData *file, const std::uint8_t *record);
+
+    inline double durationInSeconds() const {
+        return m_duration;
+    }
+    std::string_view instrumentName() const;
+    std::string_view trackName() const;
+    inline std::size_t noteCount() const {
+        return m_count;
+    }
+    inline bool sortedByStart() const {
+        return (m_flags & gwd::s_trackSortedByStart) != 0;
+    }
+
+    MappedColumn<double> startOffsets() const;
+    MappedColumn<double> durations() const;
+    MappedColumn<std::uint32_t> keyIds() const;     // ids into GwidiMappedMidiData::string()
+    MappedColumn<std::uint32_t> letterIds() const;
+    MappedColumn<std::uint32_t> instrumentIds() const;
+    MappedColumn<std::int32_t> tracks() const;
+    MappedColumn<std::int16_t> octaves() const;
+
+    // Copies one note out, interning its strings
+    Note note(std::size_t index) const;
+
+private:
+    const GwidiMappedMidiData *m_file;
+    double m_duration;
+    std::size_t m_first;
+    std::size_t m_count;
+    std::uint32_t m_instrumentName;
+    std::uint32_t m_trackName;
+    std::uint32_t m_flags;
+};
+
+// Read-only view of a raw v2 .gwd file over its mapped bytes, nothing is copied out when opening
+// For a single sorted track opening checks the header and section bounds only, so it costs the same for any song size
+// Processes mapping the same file share the one page cache copy
+class GwidiMappedMidiData {
+public:
+    // Notes of every track starting at one time, by track then index like GwidiMidiData's tick map
+    struct NoteRange {
+        double time{-1.0};          // -1.0 when there are no notes
+        std::size_t begin{0};       // [begin, end) of the only track, when it is sorted
+        std::size_t end{0};
+        FlatTickMap<NoteRef>::Span refs{};     // the notes of several tracks or of an unsorted one
+
+        inline std::size_t size() const {
+            return refs.empty() ? end - begin : refs.size();
+        }
+        // The i-th note in the range
+        inline NoteRef at(std::size_t i) const {
+            return refs.empty() ? NoteRef{0, std::uint32_t(begin + i)} : refs[i];
+        }
+    };
+
+    GwidiMappedMidiData() = default;
+    GwidiMappedMidiData(const GwidiMappedMidiData&) = delete;
+    GwidiMappedMidiData& operator=(const GwidiMappedMidiData&) = delete;
+
+    // verifyChecksum reads every byte of the file once, skip it for files this process wrote
+    bool open(const std::string &filename, bool verifyChecksum = false);
+    inline bool isOpen() const {
+        return m_file.isOpen() && m_header.string_count > 0;
+    }
+
+    inline double getTempo() const {
+        return m_header.tempo;
+    }
+    inline double getTempoMicro() const {
+        return m_header.tempo_micro;
+    }
+    // Built on each call, empty when the file has no tempo map
+    TempoMap tempoMap() const;
+
+    inline std::size_t trackCount() const {
+        return m_header.track_count;
+    }
+    MappedTrack track(std::size_t index) const;
+    // Copies the note a NoteRange entry refers to out
+    inline Note note(const NoteRef &ref) const {
+        return track(ref.track).note(ref.index);
+    }
+    std::string_view string(std::uint32_t id) const;
+    double longestTrackDuration() const;
+
+    // Same floor lookup as GwidiMidiData's tick map, over every track
+    // A single sorted track is searched in place, otherwise through an index of all tracks built once by open()
+    NoteRange floorNotes(double time) const;
+
+    // Full copy into an editable GwidiMidiData
+    GwidiMidiData *toMidiData() const;
+
+private:
+    friend class MappedTrack;
+
+    MappedFile m_file;
+    gwd::Header m_header{};
+    gwd::Sections m_sections{};
+    FlatTickMap<NoteRef> m_index;
+};
+
+}
+
+#endif //GWIDI_MIDI_PARSER_GWIDIMAPPEDMIDIDATA_H
@@ -1,11 +1,20 @@
 #ifndef GWIDI_MIDI_PARSER_GWIDIMIDIDATA_H
 #define GWIDI_MIDI_PARSER_GWIDIMIDIDATA_H
 
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <istream>
+#include <memory>
+#include <memory_resource>
 #include <vector>
 #include <string>
 #include <unordered_map>
 #include <map>
 #include "GwidiOptions2.h"
+#include "GwidiTempoMap.h"
+#include "GwidiSymbol.h"
+#include "GwidiTickMap.h"
 
 namespace gwidi::data::midi {
 
@@ -13,43 +22,224 @@ struct Note {
     double start_offset{0.0};
     double duration{0.0};
     int octave{0};
-    std::string letter{};
-    std::string instrument{};
-    int track{0};
-    std::string key{};
+    Symbol letter{};
+    Symbol instrument{};
+    int track{0};           // index of the note's track in its GwidiMidiData, not the midi track it was read from
+    Symbol key{};
 
     std::size_t hash() const {
         std::size_t h1 = std::hash<double>{}(start_offset);
         std::size_t h2 = std::hash<int>{}(octave);
-        std::size_t h3 = std::hash<std::string>{}(key);
+        std::size_t h3 = std::hash<Symbol>{}(key);
         return h1 ^ (h2 << 1) ^ (h3 << 2);
     }
 };
 
+// A track's notes stored column by column, note i is entry i of every column
+// Full passes over one field (start times, durations) stream through contiguous memory
+// Individual Notes can still be read (by value) through at() / iteration
+class NoteColumns {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Note;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Note;
+
+        const_iterator(const NoteColumns *columns, std::size_t index) : m_columns{columns}, m_index{index} {}
+
+        inline Note operator*() const {
+            return m_columns->at(m_index);
+        }
+        inline const_iterator &operator++() {
+            m_index++;
+            return *this;
+        }
+        inline bool operator==(const const_iterator &rhs) const {
+            return m_index == rhs.m_index;
+        }
+        inline bool operator!=(const const_iterator &rhs) const {
+            return m_index != rhs.m_index;
+        }
+
+    private:
+        const NoteColumns *m_columns;
+        std::size_t m_index;
+    };
+
+    NoteColumns() = default;
+    // Every column allocates from resource, it has to outlive them
+    // Copies go back to the default resource, so a copy can outlive the arena its source came from
+    explicit NoteColumns(std::pmr::memory_resource *resource);
+
+    inline std::size_t size() const {
+        return m_startOffsets.size();
+    }
+    inline bool empty() const {
+        return m_startOffsets.empty();
+    }
+    void reserve(std::size_t count);
+    void clear();
+    void emplace_back(const Note &note);
+    // Keeps the order of the notes after index
+    void erase(std::size_t index);
+    inline void push_back(const Note &note) {
+        emplace_back(note);
+    }
+
+    Note at(std::size_t index) const;
+    inline Note operator[](std::size_t index) const {
+        return at(index);
+    }
+    inline Note front() const {
+        return at(0);
+    }
+    inline Note back() const {
+        return at(size() - 1);
+    }
+    inline const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+    inline const_iterator end() const {
+        return const_iterator(this, size());
+    }
+
+    inline const std::pmr::vector<double> &startOffsets() const {
+        return m_startOffsets;
+    }
+    inline const std::pmr::vector<double> &durations() const {
+        return m_durations;
+    }
+    inline const std::pmr::vector<std::int16_t> &octaves() const {
+        return m_octaves;
+    }
+    inline const std::pmr::vector<std::int32_t> &tracks() const {
+        return m_tracks;
+    }
+    inline const std::pmr::vector<Symbol> &keys() const {
+        return m_keys;
+    }
+    inline const std::pmr::vector<Symbol> &letters() const {
+        return m_letters;
+    }
+    inline const std::pmr::vector<Symbol> &instruments() const {
+        return m_instruments;
+    }
+
+    // Bytes held by the columns
+    std::size_t memoryUsage() const;
+
+    bool operator==(const NoteColumns &rhs) const;
+    inline bool operator!=(const NoteColumns &rhs) const {
+        return !(*this == rhs);
+    }
+
+private:
+    // Fills the columns directly when loading
+    friend class GwidiMidiData;
+
+    std::pmr::vector<double> m_startOffsets;
+    std::pmr::vector<double> m_durations;
+    std::pmr::vector<std::int16_t> m_octaves;
+    std::pmr::vector<std::int32_t> m_tracks;
+    std::pmr::vector<Symbol> m_keys;
+    std::pmr::vector<Symbol> m_letters;
+    std::pmr::vector<Symbol> m_instruments;
+};
+
 struct Track {
-    std::vector<Note> notes;
-    std::string instrument_name;
-    std::string track_name;
-    double durationInSeconds;
+    NoteColumns notes{};
+    std::string instrument_name{};
+    std::string track_name{};
+    double durationInSeconds{0.0};
+};
+
+// One note of a GwidiMidiData, by its slot in getTracks() and its index in that track's columns
+struct NoteRef {
+    std::uint32_t track{0};
+    std::uint32_t index{0};
+
+    inline bool operator==(const NoteRef &rhs) const {
+        return track == rhs.track && index == rhs.index;
+    }
+    inline bool operator!=(const NoteRef &rhs) const {
+        return !(*this == rhs);
+    }
+    // The order notes of one start time are kept in
+    inline bool operator<(const NoteRef &rhs) const {
+        return track < rhs.track || (track == rhs.track && index < rhs.index);
+    }
 };
 
+// How writeToFile lays out a .gwd file (GwidiGwdFormat.h)
+enum GwdEncoding {
+    GWD_RAW = 0,        // fixed width columns, can be memory mapped
+    GWD_COMPACT = 1     // quantized varint columns, several times smaller, decoded on load
+};
+
+// Upstream of a song's arena, counts what the arena holds on to from the heap
+class ArenaUpstream : public std::pmr::memory_resource {
+public:
+    inline std::size_t bytes() const {
+        return m_bytes;
+    }
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        m_bytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+        m_bytes -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+    std::size_t m_bytes{0};
+};
+
+class GwidiMidiData;
+
+// A finished song shared read-only, by the editor, playback and previews alike
+// Nothing changes a snapshot once it is made, so any number of threads read it without copies or locks
+// Edits go through GwidiMidiData::edit() and publish a new snapshot
+using GwidiMidiSnapshot = std::shared_ptr<const GwidiMidiData>;
 
 // TODO: Rename GwidiData to GwidiMidiData
 class GwidiMidiData {
 public:
-    using TickMapType = std::map<double, std::vector<Note>>;
+    // References to the notes of every track, not copies of them
+    // The track of each note is kept, so playback can mute or solo tracks without rebuilding the map
+    using TickMapType = FlatTickMap<NoteRef>;
 
-    GwidiMidiData() = default;
+    GwidiMidiData();
+    // Sizes the arena for about noteCount notes, so loading them takes one upstream allocation
+    explicit GwidiMidiData(std::size_t noteCount);
 
+    // Both copy the notes into this song's arena, the tracks may come from anywhere (another song included)
     explicit GwidiMidiData(const std::vector<Track> &tracks);
     explicit GwidiMidiData(std::vector<Track> &&tracks);
+    // Note edits through these keep the tick map in step with the tracks
     void assignNotes(int track, const std::vector<Note> &notes);
     void addTrack(std::string instrument, std::string track_name, const std::vector<Note> &notes, double trackDurationInSeconds);
     void addNote(int track, Note &note);
+    // The notes after index move down one
+    void removeNote(int track, std::size_t index);
     void assignTempo(double tempo, double tempoMicro);
+    void assignTempoMap(TempoMap map);
+    // Rebuilds the tick map from the notes of every track
     void fillTickMap();
 
-    inline std::vector<Track> &getTracks() {
+    // Note edits between these update the tick map once, on the outermost commitEdit(), instead of one note at a time
+    void beginEdit();
+    void commitEdit();
+
+    // Read only, tracks change through the mutators above so the fingerprint and the tick map follow every edit
+    inline const std::vector<Track> &getTracks() const {
         return tracks;
     }
 
@@ -61,25 +251,102 @@ public:
         return tempoMicro;
     }
 
-    inline TickMapType &getTickMap() {
+    // Every tempo change of the song, getTempo() is only the last one
+    // Empty for data that didn't come from a midi file (the gui, older .gwd files)
+    inline const TempoMap &getTempoMap() const {
+        return tempoMap;
+    }
+
+    // Read only like getTracks(), the note mutators keep it in step with the tracks
+    inline const TickMapType &getTickMap() const {
         return tickMap;
     }
+    // The note a tick map entry refers to
+    inline Note note(const NoteRef &ref) const {
+        return tracks[ref.track].notes.at(ref.index);
+    }
 
-    void writeToFile(const std::string &filename);
+    // What the note columns and the tick map allocate from, columns added through addTrack / assignNotes use it too
+    inline std::pmr::memory_resource *getArena() const {
+        return arena.get();
+    }
+    // Heap bytes the arena holds, edits reuse what is there so this only grows with the song
+    inline std::size_t arenaFootprint() const {
+        return arenaUpstream->bytes();
+    }
+
+    // Writes the v2 format (GwidiGwdFormat.h), raw unless asked for the compact body
+    // false when the file could not be opened or fully written
+    bool writeToFile(const std::string &filename, GwdEncoding encoding = GWD_RAW) const;
+    // The bytes writeToFile writes
+    std::vector<std::uint8_t> encode(GwdEncoding encoding = GWD_RAW) const;
+    // v1, v2 or compact files, an empty snapshot when the file can't be opened or a v2 file is corrupt
+    static GwidiMidiSnapshot readSnapshot(const std::string &filename);
+    // Deprecated, the caller owns the returned data and has to delete it
+    // Use readSnapshot, and edit() on the snapshot for a copy to change
     static GwidiMidiData *readFromFile(const std::string &filename);
+    // v2 or compact, not v1
+    static GwidiMidiData *readFromMemory(const std::uint8_t *data, std::size_t size);
+    // Fingerprints first, the notes are only compared when those match
     bool operator==(const GwidiMidiData &rhs) const;
-    double longestTrackDuration();
+    // 64 bit hash of everything operator== compares, equal data always has equal fingerprints
+    // Strings are hashed by content, not by Symbol id, so it is the same in every process and can be stored
+    // Worked out on first use and kept until the data changes
+    std::uint64_t fingerprint() const;
+    double longestTrackDuration() const;
+
+    // Takes ownership of data (the raw pointers the parser, converter and readers return)
+    // Nothing may change data through another pointer afterwards, nullptr gives an empty snapshot
+    static GwidiMidiSnapshot snapshot(GwidiMidiData *data);
+    // Editable deep copy in its own arena, change it and snapshot() it to publish the edit
+    GwidiMidiData *edit() const;
 
 private:
     friend class GwidiDataConverter;
 
+    static GwidiMidiData *readV1(std::istream &in);
+    // Copies t into the arena
+    void appendTrackCopy(const Track &t);
+    // Same, moving what the arena doesn't hold (the names)
+    void appendTrack(Track &&t);
+    // Rebuilds the tick map now, or on commitEdit() during an edit
+    void refreshTickMap();
+    inline void invalidateFingerprint() {
+        fingerprintCache.store(0, std::memory_order_relaxed);
+    }
+    std::vector<std::uint8_t> encodeRaw() const;
+    // Compact encode / decode live in GwidiGwdCompact.cc
+    std::vector<std::uint8_t> encodeCompact() const;
+    static GwidiMidiData *readCompact(const std::uint8_t *data, std::size_t size);
+
+    // Per song, freed in one release when the song is dropped instead of column by column
+    // Monotonic, so memory given back (a column growing, fillTickMap rebuilding) is only reused after that
+    // Tick map rebuilds and assignNotes reuse the storage they already have, so repeated edits don't add to it
+    // Declared first so it outlives everything allocated from it
+    std::unique_ptr<ArenaUpstream> arenaUpstream;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+
     std::vector<Track> tracks;
     double tempo{0.0};
     double tempoMicro{0.0};
+    TempoMap tempoMap;
 
-    // Map of track -> [start_time, Note[]]
+    // start_time -> the notes of every track starting then, by track then index
     TickMapType tickMap;
+    int editDepth{0};
+    bool tickMapStale{false};
+
+    // 0 until worked out, concurrent readers may both work it out but always store the same value
+    mutable std::atomic<std::uint64_t> fingerprintCache{0};
 };
 
 }
+
+template<>
+struct std::hash<gwidi::data::midi::GwidiMidiData> {
+    std::size_t operator()(const gwidi::data::midi::GwidiMidiData &data) const {
+        return std::size_t(data.fingerprint());
+    }
+};
+
 #endif //GWIDI_MIDI_PARSER_GWIDIMIDIDATA_H
@@ -0,0 +1,65 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDIMIDISTREAM_H
+#define GWIDI_MIDI_PARSER_GWIDIMIDISTREAM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <vector>
+#include "GwidiMidiData.h"
+
+namespace gwidi::data::midi {
+
+// Tick map filled in time order while an import is still running, so playback can start on the first notes
+// The producer appends notes with a watermark: every note starting before it has been appended
+// Consumers must not play past watermark(), later notes may still be on their way
+class GwidiMidiStream {
+public:
+    GwidiMidiStream() = default;
+    GwidiMidiStream(const GwidiMidiStream&) = delete;
+    GwidiMidiStream& operator=(const GwidiMidiStream&) = delete;
+
+    // Producer side
+    // notes must start at or after the previous watermark
+    void append(const std::vector<Note> &notes, double watermark);
+    void finish(double durationInSeconds);
+    // The producer stops before its next chunk once set, and finishes the stream with what it has
+    inline bool cancelled() const {
+        return m_cancelled;
+    }
+
+    // Consumer side
+    inline void cancel() {
+        m_cancelled = true;
+    }
+    double watermark() const;
+    bool finished() const;
+    // Only final once finished()
+    double duration() const;
+    // Blocks until the watermark reaches time (or the stream finishes)
+    void waitForWatermark(double time) const;
+    void waitFinished() const;
+
+    // Same floor lookup as GwidiMidiData's tick map, -1.0 while nothing has been appended
+    double tickMapFloorKey(double time) const;
+    // Copies, the map keeps growing underneath
+    std::vector<Note> notesAt(double key) const;
+    // Both in one lookup under the lock, -1.0 and no notes while nothing has been appended
+    double floorNotes(double time, std::vector<Note> &out) const;
+    std::size_t noteCount() const;
+
+private:
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_cv;
+    // Notes in append order, the tick map indexes into them
+    NoteColumns m_notes;
+    FlatTickMap<std::uint32_t> m_tickMap;
+    double m_watermark{0.0};
+    double m_duration{0.0};
+    bool m_finished{false};
+    std::atomic<bool> m_cancelled{false};
+};
+
+}
+
+#endif //GWIDI_MIDI_PARSER_GWIDIMIDISTREAM_H
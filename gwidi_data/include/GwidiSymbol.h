@@ -0,0 +1,63 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDISYMBOL_H
+#define GWIDI_MIDI_PARSER_GWIDISYMBOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace gwidi::data {
+
+// An interned string, the same value always gets the same id for the life of the process
+// Compares and hashes by id, the string itself is only looked up through str() (output, .gwd files, logging)
+// Strings convert implicitly so notes can still be built from plain strings at the API boundaries
+// The table never shrinks, so only the note vocabulary (keys, letters, instrument names) goes in, that set comes
+// from the configs and stays small; track names and anything else per-file stay plain strings
+class Symbol {
+public:
+    Symbol() = default;     // the empty string
+    Symbol(const std::string &value);
+    Symbol(const char *value);
+    // Explicit, so plain string literals keep picking the const char* overload
+    explicit Symbol(std::string_view value);
+
+    const std::string &str() const;
+
+    inline std::uint32_t id() const {
+        return m_id;
+    }
+    inline bool empty() const {
+        return m_id == 0;
+    }
+
+    friend inline bool operator==(const Symbol &lhs, const Symbol &rhs) {
+        return lhs.m_id == rhs.m_id;
+    }
+    friend inline bool operator!=(const Symbol &lhs, const Symbol &rhs) {
+        return lhs.m_id != rhs.m_id;
+    }
+    // Orders by id (first interned first), not alphabetically
+    friend inline bool operator<(const Symbol &lhs, const Symbol &rhs) {
+        return lhs.m_id < rhs.m_id;
+    }
+
+    // # of distinct strings interned so far, including the empty string
+    static std::size_t count();
+    // Past this many strings the table logs a warning once, something is interning more than the note vocabulary
+    static constexpr std::size_t s_warnCount = 1 << 16;
+
+private:
+    std::uint32_t m_id{0};
+};
+
+}
+
+template<>
+struct std::hash<gwidi::data::Symbol> {
+    std::size_t operator()(const gwidi::data::Symbol &symbol) const noexcept {
+        return std::hash<std::uint32_t>{}(symbol.id());
+    }
+};
+
+#endif //GWIDI_MIDI_PARSER_GWIDISYMBOL_H
@@ -0,0 +1,61 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDITEMPOMAP_H
+#define GWIDI_MIDI_PARSER_GWIDITEMPOMAP_H
+
+#include <cstdint>
+#include <vector>
+
+namespace gwidi::data::midi {
+
+struct TempoChange {
+    std::int64_t tick{0};
+    double microseconds{0.0};       // per quarter note
+};
+
+// Every tempo of a song as a segment table, sorted by tick with the seconds / beats at each segment start precomputed
+// Any tick or time converts with a single binary search, no matter how many tempo changes came before it
+class TempoMap {
+public:
+    struct Segment {
+        std::int64_t tick{0};
+        double seconds{0.0};
+        double beats{0.0};          // quarter notes since the start of the song
+        double microseconds{0.0};   // per quarter note
+    };
+
+    TempoMap() = default;
+    // changes must be sorted by tick, the song plays at 120 bpm until the first one
+    TempoMap(double ticksPerQuarter, const std::vector<TempoChange> &changes);
+    // SMPTE timed files, ticks are a fixed fraction of a second
+    static TempoMap fromSmpte(int framesPerSecond, int ticksPerFrame);
+
+    inline bool empty() const {
+        return m_segments.empty();
+    }
+
+    inline double ticksPerQuarter() const {
+        return m_ticksPerQuarter;
+    }
+
+    inline const std::vector<Segment> &getSegments() const {
+        return m_segments;
+    }
+
+    double secondsAtTick(std::int64_t tick) const;
+    double beatsAtSeconds(double seconds) const;
+    // Index of the grid slot (divisionsPerQuarter slots per quarter note) a time falls on, rounding up
+    int gridIndexAtSeconds(double seconds, int divisionsPerQuarter) const;
+
+    bool operator==(const TempoMap &rhs) const;
+    inline bool operator!=(const TempoMap &rhs) const {
+        return !(*this == rhs);
+    }
+
+private:
+    std::vector<Segment> m_segments;
+    double m_ticksPerQuarter{0.0};
+    double m_divisor{0.0};      // microseconds per second * ticks per quarter note
+};
+
+}
+
+#endif //GWIDI_MIDI_PARSER_GWIDITEMPOMAP_H
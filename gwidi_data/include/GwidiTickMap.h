@@ -0,0 +1,320 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDITICKMAP_H
+#define GWIDI_MIDI_PARSER_GWIDITICKMAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <memory_resource>
+#include <vector>
+
+namespace gwidi::data {
+
+// Time base of every tick map, whole microseconds (the quantum compact .gwd files store starts in)
+// Notes meant for one beat share a time even when their seconds are apart by float error, and lookups compare integers
+// Seconds are only used at the API, converted on the way in and out
+using TimelineTime = std::int64_t;
+constexpr double s_timelinePerSecond = 1e6;
+
+inline TimelineTime toTimeline(double seconds) {
+    return TimelineTime(std::llround(seconds * s_timelinePerSecond));
+}
+inline double toSeconds(TimelineTime time) {
+    return double(time) / s_timelinePerSecond;
+}
+
+// Notes grouped by start time (TimelineTime), what the tick handlers look up every tick
+// All notes sit in one array ordered by time, next to a sorted array of the distinct times and the offset of each
+// time's first note, so a lookup is a binary search over contiguous integers instead of a walk down tree nodes
+template<typename T>
+class FlatTickMap {
+public:
+    // The notes of one time, contiguous in the map's note array
+    class Span {
+    public:
+        Span() = default;
+        Span(const T *data, std::size_t size) : m_data{data}, m_size{size} {}
+
+        inline const T *begin() const {
+            return m_data;
+        }
+        inline const T *end() const {
+            return m_data + m_size;
+        }
+        inline std::size_t size() const {
+            return m_size;
+        }
+        inline bool empty() const {
+            return m_size == 0;
+        }
+        inline const T &operator[](std::size_t index) const {
+            return m_data[index];
+        }
+        inline const T &at(std::size_t index) const {
+            assert(index < m_size);
+            return m_data[index];
+        }
+        inline const T &front() const {
+            return m_data[0];
+        }
+
+    private:
+        const T *m_data{nullptr};
+        std::size_t m_size{0};
+    };
+
+    // Named like std::map's value_type so iterating reads the same as the map it replaced
+    struct Entry {
+        double first{0.0};      // seconds
+        Span second{};
+    };
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Entry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Entry*;
+        using reference = const Entry&;
+
+        const_iterator(const FlatTickMap *map, std::size_t index) : m_map{map}, m_index{index} {
+            load();
+        }
+
+        inline reference operator*() const {
+            return m_entry;
+        }
+        inline pointer operator->() const {
+            return &m_entry;
+        }
+        inline const_iterator &operator++() {
+            m_index++;
+            load();
+            return *this;
+        }
+        inline const_iterator operator++(int) {
+            auto ret = *this;
+            ++(*this);
+            return ret;
+        }
+        inline bool operator==(const const_iterator &rhs) const {
+            return m_index == rhs.m_index;
+        }
+        inline bool operator!=(const const_iterator &rhs) const {
+            return m_index != rhs.m_index;
+        }
+
+    private:
+        inline void load() {
+            if(m_index < m_map->size()) {
+                m_entry = Entry{m_map->keyAt(m_index), m_map->notesAtIndex(m_index)};
+            }
+        }
+
+        const FlatTickMap *m_map;
+        std::size_t m_index;
+        Entry m_entry{};
+    };
+
+    FlatTickMap() = default;
+    // All 3 arrays allocate from resource, it has to outlive the map
+    explicit FlatTickMap(std::pmr::memory_resource *resource) : m_times{resource}, m_offsets{resource}, m_notes{resource} {}
+
+    inline std::pmr::memory_resource *resource() const {
+        return m_notes.get_allocator().resource();
+    }
+
+    // # of distinct times
+    inline std::size_t size() const {
+        return m_times.size();
+    }
+    inline bool empty() const {
+        return m_times.empty();
+    }
+    inline std::size_t noteCount() const {
+        return m_notes.size();
+    }
+    inline const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+    inline const_iterator end() const {
+        return const_iterator(this, size());
+    }
+
+    inline void clear() {
+        m_times.clear();
+        m_offsets.clear();
+        m_notes.clear();
+    }
+    inline void reserve(std::size_t times, std::size_t notes) {
+        m_times.reserve(times);
+        m_offsets.reserve(times);
+        m_notes.reserve(notes);
+    }
+
+    // Building in time order only ever appends, anything earlier than the last time is inserted in place
+    void insert(double seconds, const T &note) {
+        insert(seconds, note, [](const T&, const T&) {
+            return false;
+        });
+    }
+
+    // Same, but the notes of one time stay ordered by less, note goes behind every note it isn't less than
+    template<typename Less>
+    void insert(double seconds, const T &note, Less less) {
+        auto time = toTimeline(seconds);
+        if(m_times.empty() || time > m_times.back()) {
+            m_times.emplace_back(time);
+            m_offsets.emplace_back(std::uint32_t(m_notes.size()));
+            m_notes.emplace_back(note);
+            return;
+        }
+        auto index = std::size_t(std::lower_bound(m_times.begin(), m_times.end(), time) - m_times.begin());
+        if(m_times[index] != time) {
+            m_times.insert(m_times.begin() + index, time);
+            m_offsets.insert(m_offsets.begin() + index, m_offsets[index]);
+        }
+        // Everything after it moves up one
+        auto first = m_notes.begin() + m_offsets[index];
+        auto position = std::upper_bound(first, m_notes.begin() + endOffset(index), note, less);
+        m_notes.insert(position, note);
+        for(auto i = index + 1; i < m_offsets.size(); i++) {
+            m_offsets[i]++;
+        }
+    }
+
+    // Takes over notes already sorted by toTimeline(seconds(note)), one pass to find where each time starts
+    // Build notes on resource() so they are moved in, not copied
+    template<typename SecondsFn>
+    void assignSorted(std::pmr::vector<T> &&notes, SecondsFn seconds) {
+        m_times.clear();
+        m_offsets.clear();
+        m_notes = std::move(notes);
+        for(std::size_t i = 0; i < m_notes.size(); i++) {
+            auto t = toTimeline(seconds(m_notes[i]));
+            if(m_times.empty() || t != m_times.back()) {
+                m_times.emplace_back(t);
+                m_offsets.emplace_back(std::uint32_t(i));
+            }
+        }
+    }
+
+    // Empties the map and hands over its note array, capacity kept, to refill and give back through assignSorted
+    // Rebuilding that way reuses the array instead of allocating a new one each time
+    std::pmr::vector<T> takeNotes() {
+        m_times.clear();
+        m_offsets.clear();
+        std::pmr::vector<T> notes(std::move(m_notes));
+        notes.clear();
+        return notes;
+    }
+
+    // Removes the first note at time matching pred, and the time itself once it has no notes left
+    template<typename Pred>
+    bool eraseIf(double seconds, Pred pred) {
+        auto index = find(seconds);
+        if(index == npos) {
+            return false;
+        }
+        auto first = m_notes.begin() + m_offsets[index];
+        auto last = m_notes.begin() + endOffset(index);
+        auto it = std::find_if(first, last, pred);
+        if(it == last) {
+            return false;
+        }
+        m_notes.erase(it);
+        for(auto i = index + 1; i < m_offsets.size(); i++) {
+            m_offsets[i]--;
+        }
+        if(m_offsets[index] == endOffset(index)) {
+            m_times.erase(m_times.begin() + index);
+            m_offsets.erase(m_offsets.begin() + index);
+        }
+        return true;
+    }
+
+    // Applies fn to every note in place, times and grouping stay as they are
+    // For notes that are indices into another array, when entries of that array move
+    template<typename Fn>
+    void updateNotes(Fn fn) {
+        for(auto &note : m_notes) {
+            fn(note);
+        }
+    }
+
+    // Same, for the notes of one time only
+    template<typename Fn>
+    void updateNotesAt(double seconds, Fn fn) {
+        auto index = find(seconds);
+        if(index == npos) {
+            return;
+        }
+        for(auto i = std::size_t(m_offsets[index]); i < endOffset(index); i++) {
+            fn(m_notes[i]);
+        }
+    }
+
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    // Index of the time seconds falls on, npos when no note starts there
+    std::size_t find(double seconds) const {
+        auto time = toTimeline(seconds);
+        auto it = std::lower_bound(m_times.begin(), m_times.end(), time);
+        if(it == m_times.end() || *it != time) {
+            return npos;
+        }
+        return std::size_t(it - m_times.begin());
+    }
+
+    // 3 cases, same as the std::map lookups this replaced:
+    // 1 - time is <= all keys, the first key
+    // 2 - time is > some keys, <= some keys, the key before the first one >= time
+    // 3 - time is > all keys, the last key
+    // npos when empty
+    std::size_t floorIndex(double seconds) const {
+        if(m_times.empty()) {
+            return npos;
+        }
+        auto time = toTimeline(seconds);
+        auto index = std::size_t(std::lower_bound(m_times.begin(), m_times.end(), time) - m_times.begin());
+        return index == 0 ? 0 : index - 1;
+    }
+
+    // In seconds
+    inline double keyAt(std::size_t index) const {
+        return toSeconds(m_times[index]);
+    }
+    inline TimelineTime timeAt(std::size_t index) const {
+        return m_times[index];
+    }
+    inline Span notesAtIndex(std::size_t index) const {
+        return Span(m_notes.data() + m_offsets[index], endOffset(index) - m_offsets[index]);
+    }
+    // Empty when no note starts at seconds
+    inline Span notesAt(double seconds) const {
+        auto index = find(seconds);
+        return index == npos ? Span() : notesAtIndex(index);
+    }
+
+    inline bool operator==(const FlatTickMap &rhs) const {
+        return m_times == rhs.m_times && m_offsets == rhs.m_offsets && m_notes == rhs.m_notes;
+    }
+    inline bool operator!=(const FlatTickMap &rhs) const {
+        return !(*this == rhs);
+    }
+
+private:
+    inline std::size_t endOffset(std::size_t index) const {
+        return index + 1 < m_offsets.size() ? m_offsets[index + 1] : m_notes.size();
+    }
+
+    std::pmr::vector<TimelineTime> m_times;
+    std::pmr::vector<std::uint32_t> m_offsets;
+    std::pmr::vector<T> m_notes;
+};
+
+}
+
+#endif //GWIDI_MIDI_PARSER_GWIDITICKMAP_H
@@ -61,11 +61,34 @@ void test_instrument(const std::string &instr) {
     test_measure(1, measures, options);
 }
 
+void test_toggle() {
+    gwidi::data::gui::GwidiGuiData data("default");
+    auto &measures = data.getMeasures();
+    data.addMeasure();
+    auto &later = measures.at(1).octaves.at(0).notes[4].front();
+    auto &earlier = measures.at(0).octaves.at(0).notes[2].front();
+    auto &chord = measures.at(0).octaves.at(0).notes[2].back();
+
+    // Toggled out of time order, the map still comes out sorted
+    data.toggleNote(&later);
+    data.toggleNote(&earlier);
+    data.toggleNote(&chord);
+    auto &tickMap = data.getTickMap();
+    assert(tickMap.size() == 2 && tickMap.noteCount() == 3);
+    assert(tickMap.timeAt(0) == gwidi::data::toTimeline(data.timeIndexToTickOffset(&earlier)) && tickMap.notesAtIndex(0).size() == 2);
+    assert(tickMap.floorIndex(tickMap.keyAt(1) + 1.0) == 1);
+
+    data.toggleNote(&earlier);
+    data.toggleNote(&chord);
+    assert(tickMap.size() == 1 && tickMap.notesAt(data.timeIndexToTickOffset(&later)).front().key == later.key);
+}
+
 int main() {
     test_instrument("default");
     test_instrument("harp");
     test_instrument("bell");
     test_instrument("flute");
+    test_toggle();
 
     return 0;
 }
@@ -0,0 +1,102 @@
+#include "gwidi_midi_batch.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// gwidi_midi_batch <midi dir> <output dir> [-i instrument]... [-t <track index>|most|all] [-j threads] [-r]
+void usage(const char* name) {
+    spdlog::info("usage: {} <midi dir> <output dir> [-i instrument]... [-t <track index>|most|all] [-j threads] [-r]", name);
+    spdlog::info("  -i  instrument mapping to convert with, repeat for several (default: default)");
+    spdlog::info("  -t  track to convert: an index, the track with the most notes, or all tracks (default: most)");
+    spdlog::info("  -j  worker threads (default: hardware concurrency)");
+    spdlog::info("  -r  include sub directories");
+}
+
+// A whole, non-negative decimal number, anything else is a usage error
+bool parseCount(const char* arg, int &out) {
+    char* end = nullptr;
+    errno = 0;
+    auto value = std::strtol(arg, &end, 10);
+    if(end == arg || *end != '\0' || errno == ERANGE || value < 0 || value > INT_MAX) {
+        return false;
+    }
+    out = int(value);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    spdlog::set_level(spdlog::level::info);
+    if(argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    gwidi::midi::MidiBatchOptions options;
+    options.input_dir = argv[1];
+    options.output_dir = argv[2];
+    options.instruments.clear();
+    for(auto i = 3; i < argc; i++) {
+        auto hasValue = i + 1 < argc;
+        if(!strcmp(argv[i], "-i") && hasValue) {
+            options.instruments.emplace_back(argv[++i]);
+        }
+        else if(!strcmp(argv[i], "-t") && hasValue) {
+            std::string track = argv[++i];
+            if(track == "most") {
+                options.track_select = gwidi::midi::SELECT_MOST_NOTES;
+            }
+            else if(track == "all") {
+                options.track_select = gwidi::midi::SELECT_ALL_TRACKS;
+            }
+            else if(parseCount(track.c_str(), options.chosen_track)) {
+                options.track_select = gwidi::midi::SELECT_TRACK_INDEX;
+            }
+            else {
+                spdlog::error("invalid track: {}", track);
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if(!strcmp(argv[i], "-j") && hasValue) {
+            int threads;
+            if(!parseCount(argv[++i], threads)) {
+                spdlog::error("invalid thread count: {}", argv[i]);
+                usage(argv[0]);
+                return 1;
+            }
+            options.thread_count = unsigned(threads);
+        }
+        else if(!strcmp(argv[i], "-r")) {
+            options.recursive = true;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(options.instruments.empty()) {
+        options.instruments.emplace_back("default");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto results = gwidi::midi::GwidiMidiBatchImporter::run(options, [](const gwidi::midi::MidiBatchFileResult &result) {
+        if(result.ok()) {
+            spdlog::info("{}: decode: {:.3f} ms, convert: {:.3f} ms, write: {:.3f} ms, {} output(s)", result.input, result.decode_ms, result.convert_ms, result.write_ms, result.outputs.size());
+        }
+        else {
+            spdlog::error("{}: {}", result.input, result.error);
+        }
+    });
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    auto failed = std::count_if(results.begin(), results.end(), [](const gwidi::midi::MidiBatchFileResult &result) {
+        return !result.ok();
+    });
+    spdlog::info("Converted {} of {} midi files in {:.1f} ms, {} failed", results.size() - failed, results.size(), elapsed, failed);
+    return failed == 0 ? 0 : 2;
+}
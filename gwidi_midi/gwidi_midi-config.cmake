@@ -12,7 +12,10 @@ if(NOT TARGET gwidi_data)
     find_package(gwidi_data REQUIRED)
 endif()
 
-if(NOT TARGET midifile)
+# The native decoder handles imports, midifile is only kept around as a fallback for files it rejects
+option(GWIDI_MIDI_WITH_MIDIFILE "Build midifile in as a fallback midi decoder" ON)
+
+if(GWIDI_MIDI_WITH_MIDIFILE AND NOT TARGET midifile)
     set(midifile_DIR ${CMAKE_CURRENT_LIST_DIR}/midifile)
     find_package(midifile REQUIRED)
     message("midifile_INCLUDE_DIRS: ${midifile_INCLUDE_DIRS}")
@@ -22,23 +25,35 @@ endif()
 add_library(gwidi_midi)
 target_sources(gwidi_midi PUBLIC
         ${CMAKE_CURRENT_LIST_DIR}/gwidi_midi_parser.cc
+        ${CMAKE_CURRENT_LIST_DIR}/gwidi_midi_document.cc
+        ${CMAKE_CURRENT_LIST_DIR}/gwidi_smf_decoder.cc
+        ${CMAKE_CURRENT_LIST_DIR}/gwidi_midi_import_cache.cc
+        ${CMAKE_CURRENT_LIST_DIR}/gwidi_midi_batch.cc
+        ${CMAKE_CURRENT_LIST_DIR}/gwidi_midi_import_handle.cc
 )
 
-add_dependencies(gwidi_midi ${midifile_LIBRARIES})
 target_include_directories(gwidi_midi PUBLIC
         ${CMAKE_CURRENT_LIST_DIR}/include
         ${gwidi_data_INCLUDE_DIRS}
         ${gwidi_options_INCLUDE_DIRS}
         ${gwidi_options_2_INCLUDE_DIRS}
-        ${midifile_INCLUDE_DIRS}
 )
 target_link_libraries(gwidi_midi PRIVATE
         spdlog::spdlog
         ${gwidi_data_LIBRARIES}
         ${gwidi_options_LIBRARIES}
         ${gwidi_options_2_LIBRARIES}
-        ${midifile_LIBRARIES}
 )
 
+if(GWIDI_MIDI_WITH_MIDIFILE)
+    target_sources(gwidi_midi PUBLIC
+            ${CMAKE_CURRENT_LIST_DIR}/gwidi_smf_midifile.cc
+    )
+    add_dependencies(gwidi_midi ${midifile_LIBRARIES})
+    target_include_directories(gwidi_midi PUBLIC ${midifile_INCLUDE_DIRS})
+    target_compile_definitions(gwidi_midi PUBLIC GWIDI_MIDI_WITH_MIDIFILE)
+    target_link_libraries(gwidi_midi PRIVATE ${midifile_LIBRARIES})
+endif()
+
 set(gwidi_midi_INCLUDE_DIRS ${CMAKE_CURRENT_LIST_DIR}/include)
 set(gwidi_midi_LIBRARIES gwidi_midi ${midifile_LIBRARIES})
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include "spdlog/spdlog.h"
+#include "gwidi_midi_batch.h"
+#include "gwidi_midi_document.h"
+#include "GwidiMidiData.h"
+#include "GwidiOptions2.h"
+
+namespace gwidi::midi {
+
+namespace {
+
+inline double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<MidiParseOptions> selectTracks(const MidiDocument &doc, const MidiBatchOptions &options, const std::string &instrument) {
+    std::vector<MidiParseOptions> trackOptions;
+    auto &meta = doc.getTrackMetaMap();
+    switch(options.track_select) {
+        case SELECT_TRACK_INDEX:
+            trackOptions.emplace_back(MidiParseOptions{instrument, options.chosen_track});
+            break;
+        case SELECT_MOST_NOTES: {
+            auto most = std::max_element(meta.begin(), meta.end(), [](const auto &a, const auto &b) {
+                return a.second.num_notes < b.second.num_notes;
+            });
+            if(most != meta.end() && most->second.num_notes > 0) {
+                trackOptions.emplace_back(MidiParseOptions{instrument, most->first});
+            }
+            break;
+        }
+        case SELECT_ALL_TRACKS:
+            for(auto &entry : meta) {
+                if(entry.second.num_notes > 0) {
+                    trackOptions.emplace_back(MidiParseOptions{instrument, entry.first});
+                }
+            }
+            break;
+    }
+    return trackOptions;
+}
+
+}
+
+MidiBatchFileResult GwidiMidiBatchImporter::importFile(const std::string &midiPath, const MidiBatchOptions &options) {
+    MidiBatchFileResult result;
+    result.input = midiPath;
+
+    std::error_code ec;
+    auto relative = std::filesystem::relative(midiPath, options.input_dir, ec);
+    if(ec || relative.empty()) {
+        relative = std::filesystem::path(midiPath).filename();
+    }
+    auto outDir = (std::filesystem::path(options.output_dir) / relative).parent_path();
+    std::filesystem::create_directories(outDir, ec);
+    if(ec) {
+        result.error = "failed to create output dir: " + outDir.string();
+        return result;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto doc = GwidiMidiParser::getInstance().openDocument(midiPath.c_str());
+    result.decode_ms = msSince(start);
+    if(doc->trackCount() == 0) {
+        result.error = "no tracks decoded";
+        return result;
+    }
+
+    for(auto &instrument : options.instruments) {
+        if(!gwidi::options2::GwidiOptions2::getInstance().noteLookup(instrument)) {
+            result.error = "no instrument mapping for: " + instrument;
+            return result;
+        }
+        auto trackOptions = selectTracks(*doc, options, instrument);
+        if(trackOptions.empty()) {
+            result.error = "no track matches the track selection";
+            return result;
+        }
+
+        // The batch already keeps every core busy with files, so tracks are converted on this worker
+        start = std::chrono::steady_clock::now();
+        std::unique_ptr<gwidi::data::midi::GwidiMidiData> data(doc->convertTracks(trackOptions, 1));
+        result.convert_ms += msSince(start);
+        if(data->getTracks().empty()) {
+            result.error = "chosen_track: " + std::to_string(options.chosen_track) + " is not in the file";
+            return result;
+        }
+
+        // The midi extension is kept, song.mid and song.midi in one dir don't write over each other
+        auto outPath = (outDir / (relative.filename().string() + "." + instrument + ".gwd")).string();
+        start = std::chrono::steady_clock::now();
+        auto written = data->writeToFile(outPath);
+        result.write_ms += msSince(start);
+        if(!written) {
+            result.error = "failed to write: " + outPath;
+            return result;
+        }
+        result.outputs.emplace_back(outPath);
+    }
+    return result;
+}
+
+std::vector<MidiBatchFileResult> GwidiMidiBatchImporter::run(const MidiBatchOptions &options, const FileDoneCallback &onFileDone) {
+    std::vector<std::string> files;
+    std::error_code ec;
+    auto collect = [&files](const std::filesystem::directory_entry &entry) {
+        auto ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+            return char(std::tolower(c));
+        });
+        std::error_code typeEc;
+        if(entry.is_regular_file(typeEc) && (ext == ".mid" || ext == ".midi")) {
+            files.emplace_back(entry.path().string());
+        }
+    };
+    // Incremented through the error_code overloads, an unreadable entry ends the listing instead of throwing
+    if(options.recursive) {
+        std::filesystem::recursive_directory_iterator it(options.input_dir, std::filesystem::directory_options::skip_permission_denied, ec);
+        for(; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            collect(*it);
+        }
+    }
+    else {
+        std::filesystem::directory_iterator it(options.input_dir, ec);
+        for(; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            collect(*it);
+        }
+    }
+    if(ec) {
+        spdlog::warn("Failed to list midi dir: {}, {}", options.input_dir, ec.message());
+    }
+    std::sort(files.begin(), files.end());
+    spdlog::debug("Batch importing {} midi files", files.size());
+
+    // Load the instrument mapping before the workers race for it
+    gwidi::options2::GwidiOptions2::getInstance();
+
+    std::vector<MidiBatchFileResult> results(files.size());
+    std::atomic<std::size_t> next{0};
+    auto worker = [&files, &results, &next, &options, &onFileDone]() {
+        for(auto index = next++; index < files.size(); index = next++) {
+            results[index] = importFile(files[index], options);
+            if(onFileDone) {
+                onFileDone(results[index]);
+            }
+        }
+    };
+
+    auto threadCount = options.thread_count;
+    if(threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = std::min<std::size_t>(threadCount, files.size());
+    if(threadCount <= 1) {
+        worker();
+    }
+    else {
+        std::vector<std::thread> pool;
+        for(std::size_t i = 0; i < threadCount; i++) {
+            pool.emplace_back(worker);
+        }
+        for(auto &th : pool) {
+            th.join();
+        }
+    }
+    return results;
+}
+
+}
@@ -0,0 +1,296 @@
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include "spdlog/spdlog.h"
+#include "gwidi_midi_document.h"
+#include "GwidiMidiData.h"
+#include "GwidiMappedFile.h"
+#include "GwidiMidiStream.h"
+#include "GwidiOptions2.h"
+
+namespace gwidi::midi {
+
+std::shared_ptr<MidiDocument> MidiDocument::open(const char *midiName) {
+    std::ifstream in(midiName, std::ios::in | std::ios::binary);
+    if(!in.is_open()) {
+        spdlog::warn("Failed to open midi file: {}", midiName);
+    }
+    std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    return open(bytes.data(), bytes.size());
+}
+
+std::shared_ptr<MidiDocument> MidiDocument::open(const std::uint8_t *data, std::size_t size) {
+    auto doc = std::shared_ptr<MidiDocument>(new MidiDocument());
+    if(!SmfDecoder::decode(data, size, doc->m_data)) {
+#if defined(GWIDI_MIDI_WITH_MIDIFILE)
+        spdlog::info("Native decoder rejected the midi data, falling back to midifile");
+        SmfDecoder::decodeWithMidifile(data, size, doc->m_data);
+#else
+        spdlog::warn("Failed to decode midi data");
+#endif
+    }
+    spdlog::debug("Ticks Per Quarter Note: {}", doc->m_data.ticks_per_quarter);
+    spdlog::debug("# Tracks: {}", doc->m_data.tracks.size());
+
+    analyzeTracks(doc->m_data, doc->m_trackMeta);
+    return doc;
+}
+
+std::shared_ptr<MidiDocument> MidiDocument::openMapped(const char *midiName) {
+    gwidi::data::MappedFile mapped(midiName);
+    return open(mapped.data(), mapped.size());
+}
+
+GwidiMidiParser::TrackMeta MidiDocument::skimTrackMeta(const char *midiName, MidiReadMode mode) {
+    if(mode == READ_MAPPED) {
+        gwidi::data::MappedFile mapped(midiName);
+        return skimTrackMeta(mapped.data(), mapped.size());
+    }
+    std::ifstream in(midiName, std::ios::in | std::ios::binary);
+    if(!in.is_open()) {
+        spdlog::warn("Failed to open midi file: {}", midiName);
+    }
+    std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    return skimTrackMeta(bytes.data(), bytes.size());
+}
+
+GwidiMidiParser::TrackMeta MidiDocument::skimTrackMeta(const std::uint8_t *data, std::size_t size) {
+    SmfData skimmed;
+    if(!SmfDecoder::decode(data, size, skimmed, DECODE_SKIM)) {
+#if defined(GWIDI_MIDI_WITH_MIDIFILE)
+        spdlog::info("Native decoder rejected the midi data, falling back to midifile");
+        SmfDecoder::decodeWithMidifile(data, size, skimmed);
+#else
+        spdlog::warn("Failed to decode midi data");
+#endif
+    }
+    GwidiMidiParser::TrackMeta trackMeta;
+    analyzeTracks(skimmed, trackMeta);
+    return trackMeta;
+}
+
+int MidiDocument::trackCount() const {
+    return int(m_data.tracks.size());
+}
+
+void MidiDocument::analyzeTracks(const SmfData &data, GwidiMidiParser::TrackMeta &trackMeta) {
+    for(auto i = 0; i < int(data.tracks.size()); i++) {
+        auto &track = data.tracks[i];
+        auto &stats = trackMeta[i];
+        stats = MidiParseTrackStats{};
+        stats.name = track.name;
+        stats.instrument = track.first_instrument;
+        stats.num_notes = track.num_note_ons;
+        stats.tempo = track.tempo;
+        stats.duration = track.end_seconds;
+        for(auto channel = 0; channel < int(track.channel_note_ons.size()); channel++) {
+            if(track.channel_note_ons[channel] > 0) {
+                auto program = track.channel_programs[channel];
+                stats.channels[channel] = MidiParseChannelStats{
+                        program >= 0 ? SmfDecoder::programName(program) : "",
+                        track.channel_note_ons[channel]
+                };
+            }
+        }
+    }
+}
+
+gwidi::data::midi::GwidiMidiData* MidiDocument::convert(const MidiParseOptions &options) const {
+    return convertTracks({options}, 1);
+}
+
+gwidi::data::midi::GwidiMidiData* MidiDocument::convertAllTracks(const std::string &instrument, unsigned int threadCount) const {
+    std::vector<MidiParseOptions> trackOptions;
+    for(auto i = 0; i < trackCount(); i++) {
+        trackOptions.emplace_back(MidiParseOptions{instrument, i});
+    }
+    return convertTracks(trackOptions, threadCount);
+}
+
+gwidi::data::midi::GwidiMidiData* MidiDocument::convertAllChannels(int track, const std::string &instrument, unsigned int threadCount) const {
+    std::vector<MidiParseOptions> trackOptions;
+    auto meta = m_trackMeta.find(track);
+    if(meta != m_trackMeta.end()) {
+        for(auto &channel : meta->second.channels) {
+            trackOptions.emplace_back(MidiParseOptions{instrument, track, channel.first});
+        }
+    }
+    return convertTracks(trackOptions, threadCount);
+}
+
+gwidi::data::midi::GwidiMidiData* MidiDocument::convertTracks(const std::vector<MidiParseOptions> &trackOptions, unsigned int threadCount, const ProgressCallback &onProgress) const {
+    gwidi::options2::GwidiOptions2::getInstance();   // initialize our instrument mapping before any worker needs it
+
+    std::vector<MidiParseOptions> valid;
+    std::size_t noteCount{0};
+    for(auto &options : trackOptions) {
+        if(options.chosen_track < 0 || options.chosen_track >= trackCount()) {
+            spdlog::warn("chosen_track: {} is not in the document, # Tracks: {}", options.chosen_track, trackCount());
+            continue;
+        }
+        if(options.chosen_channel < -1 || options.chosen_channel > 15) {
+            spdlog::warn("chosen_channel: {} is not a midi channel", options.chosen_channel);
+            continue;
+        }
+        valid.emplace_back(options);
+        noteCount += m_data.tracks[options.chosen_track].notes.size();
+    }
+
+    // The track's note count bounds what a channel of it converts to, so the arena is sized once
+    auto outData = new gwidi::data::midi::GwidiMidiData(noteCount);
+    outData->assignTempo(m_data.tempo, m_data.tempo_micro);
+    outData->assignTempoMap(m_data.tempo_map);
+    if(valid.empty()) {
+        return outData;
+    }
+
+    // Each worker pulls the next track to convert, results are kept in their requested slot
+    std::vector<ConvertedTrack> converted(valid.size());
+    std::atomic<std::size_t> next{0};
+    std::atomic<int> done{0};
+    std::atomic<bool> stopped{false};
+    auto worker = [this, &valid, &converted, &next, &done, &stopped, &onProgress]() {
+        for(auto index = next++; index < valid.size() && !stopped; index = next++) {
+            convertTrack(valid[index], int(index), converted[index]);
+            if(onProgress && !onProgress(++done, int(valid.size()))) {
+                stopped = true;
+            }
+        }
+    };
+
+    if(threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = std::min<std::size_t>(threadCount, valid.size());
+    if(threadCount <= 1) {
+        worker();
+    }
+    else {
+        std::vector<std::thread> pool;
+        for(std::size_t i = 0; i < threadCount; i++) {
+            pool.emplace_back(worker);
+        }
+        for(auto &th : pool) {
+            th.join();
+        }
+    }
+    if(stopped) {
+        delete outData;
+        return nullptr;
+    }
+
+    // The tick map is built once, over all tracks (a k-way merge in fillTickMap), when commitEdit() runs
+    outData->beginEdit();
+    for(auto &track : converted) {
+        outData->addTrack(std::move(track.instrument), std::move(track.track_name), track.notes, track.durationInSeconds);
+    }
+    outData->commitEdit();
+    return outData;
+}
+
+void MidiDocument::convertTrack(const MidiParseOptions &options, int slot, ConvertedTrack &out) const {
+    // Resolve the instrument once, every note is then a table index
+    auto lookup = gwidi::options2::GwidiOptions2::getInstance().noteLookup(options.instrument);
+    if(!lookup) {
+        spdlog::warn("No instrument mapping for: {}", options.instrument);
+    }
+
+    auto i = options.chosen_track;
+    spdlog::debug("Track: {}", i);
+    auto &track = m_data.tracks[i];
+
+    out.instrument = track.instrument;
+    out.track_name = track.name;
+    if(options.chosen_channel >= 0 && options.chosen_channel < int(track.channel_programs.size())) {
+        // A channel of the track on its own, named after the channel's program where it has one
+        auto program = track.channel_programs[options.chosen_channel];
+        if(program >= 0) {
+            out.instrument = SmfDecoder::programName(program);
+        }
+        out.track_name += " (channel " + std::to_string(options.chosen_channel + 1) + ")";
+    }
+    out.durationInSeconds = track.end_seconds;
+    out.notes.reserve(track.notes.size());
+    convertNotes(options, slot, lookup.get(), 0, track.notes.size(), out.notes);
+}
+
+void MidiDocument::convertNotes(const MidiParseOptions &options, int slot, const gwidi::options2::MidiNoteLookup *lookup, std::size_t begin, std::size_t end, std::vector<gwidi::data::midi::Note> &out) const {
+    auto &track = m_data.tracks[options.chosen_track];
+    // Intern the letter / mapped key of each midi key once per call instead of once per note
+    std::array<gwidi::data::Symbol, 128> letters;
+    std::array<gwidi::data::Symbol, 128> keys;
+    std::array<bool, 128> interned{};
+    for(auto index = begin; index < end; index++) {
+        auto &event = track.notes[index];
+        if(options.chosen_channel >= 0 && event.channel != options.chosen_channel) {
+            continue;
+        }
+        spdlog::debug("startSeconds: {}\nduration: {}\nnumber: {}", event.start_seconds, event.duration_seconds, event.key);
+
+        // When adding a note, determine the 'Note' class variables via our instrumentMapping options
+        // If a note doesn't exist in our mapping, it shouldn't be used
+        auto optionsNote = lookup ? lookup->find(event.key) : nullptr;
+        if(optionsNote) {
+            if(!interned[event.key]) {
+                letters[event.key] = SmfDecoder::keyLetter(event.key);
+                keys[event.key] = optionsNote->key;
+                interned[event.key] = true;
+            }
+            out.emplace_back(gwidi::data::midi::Note{
+                    event.start_seconds,
+                    event.duration_seconds,
+                    optionsNote->instrument_octave,
+                    letters[event.key],
+                    {},
+                    slot,
+                    keys[event.key]
+            });
+        }
+    }
+}
+
+void MidiDocument::streamTrack(const MidiParseOptions &options, gwidi::data::midi::GwidiMidiStream &stream, std::size_t notesPerChunk) const {
+    if(options.chosen_track < 0 || options.chosen_track >= trackCount()) {
+        spdlog::warn("chosen_track: {} is not in the document, # Tracks: {}", options.chosen_track, trackCount());
+        stream.finish(0.0);
+        return;
+    }
+    if(options.chosen_channel < -1 || options.chosen_channel > 15) {
+        spdlog::warn("chosen_channel: {} is not a midi channel", options.chosen_channel);
+        stream.finish(0.0);
+        return;
+    }
+    auto lookup = gwidi::options2::GwidiOptions2::getInstance().noteLookup(options.instrument);
+    if(!lookup) {
+        spdlog::warn("No instrument mapping for: {}", options.instrument);
+    }
+
+    // Notes are in note-on order, which is start time order, so each chunk only holds notes at or after the last watermark
+    auto &notes = m_data.tracks[options.chosen_track].notes;
+    std::vector<gwidi::data::midi::Note> chunk;
+    std::size_t begin = 0;
+    double watermark = 0.0;
+    while(begin < notes.size()) {
+        if(stream.cancelled()) {
+            spdlog::debug("Streaming import cancelled after {} of {} notes", begin, notes.size());
+            stream.finish(watermark);
+            return;
+        }
+        auto end = std::min(notes.size(), begin + std::max<std::size_t>(notesPerChunk, 1));
+        // Don't split a chord across chunks, it would play in two halves
+        while(end < notes.size() && notes[end].start_tick == notes[end - 1].start_tick) {
+            end++;
+        }
+        chunk.clear();
+        convertNotes(options, 0, lookup.get(), begin, end, chunk);
+        watermark = end < notes.size() ? notes[end].start_seconds : m_data.tracks[options.chosen_track].end_seconds;
+        stream.append(chunk, watermark);
+        begin = end;
+    }
+    stream.finish(m_data.tracks[options.chosen_track].end_seconds);
+}
+
+}
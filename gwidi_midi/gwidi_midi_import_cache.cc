@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include "spdlog/spdlog.h"
+#include "gwidi_midi_import_cache.h"
+#include "GwidiOptions2.h"
+
+namespace gwidi::midi {
+
+namespace {
+
+// Bumped whenever the stored .gwd layout or the conversion changes, so stale entries stop matching
+constexpr std::uint64_t s_cacheVersion = 6;
+
+// Temp files this old are left over from a writer that died before its rename, younger ones may still be in use
+constexpr auto s_staleTempAge = std::chrono::minutes(10);
+
+using gwidi::options2::fnv1a;
+using gwidi::options2::s_fnvOffset;
+
+}
+
+GwidiMidiImportCache::GwidiMidiImportCache(std::string cacheDir, std::uintmax_t maxBytes) : m_cacheDir{std::move(cacheDir)}, m_maxBytes{maxBytes} {
+    std::error_code ec;
+    std::filesystem::create_directories(m_cacheDir, ec);
+    if(ec) {
+        spdlog::warn("Failed to create import cache dir: {}, {}", m_cacheDir, ec.message());
+    }
+    loadIndex();
+}
+
+std::uint64_t GwidiMidiImportCache::cacheKey(const std::uint8_t *data, std::size_t size, const MidiParseOptions &options) {
+    auto h = fnv1a(s_fnvOffset, s_cacheVersion);
+    h = fnv1a(h, data, size);
+    h = fnv1a(h, options.instrument.data(), options.instrument.size());
+    h = fnv1a(h, options.chosen_track);
+    h = fnv1a(h, options.chosen_channel);
+    h = fnv1a(h, gwidi::options2::GwidiOptions2::getInstance().configFingerprint());
+    return h;
+}
+
+std::string GwidiMidiImportCache::entryPath(std::uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.gwd", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(m_cacheDir) / name).string();
+}
+
+// Pick up entries from earlier runs, oldest modification time is the least recently used
+// Temp files a crashed writer left behind are removed on the way
+void GwidiMidiImportCache::loadIndex() {
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    m_index.clear();
+    m_bytes = 0;
+
+    std::vector<std::pair<std::filesystem::file_time_type, std::uint64_t>> byAge;
+    std::vector<std::filesystem::path> staleTemps;
+    auto now = std::filesystem::file_time_type::clock::now();
+    std::error_code ec;
+    for(auto &entry : std::filesystem::directory_iterator(m_cacheDir, ec)) {
+        if(entry.path().extension() == ".tmp") {
+            std::error_code timeEc;
+            auto written = entry.last_write_time(timeEc);
+            if(!timeEc && now - written > s_staleTempAge) {
+                staleTemps.emplace_back(entry.path());
+            }
+            continue;
+        }
+        if(entry.path().extension() != ".gwd") {
+            continue;
+        }
+        auto key = std::strtoull(entry.path().stem().string().c_str(), nullptr, 16);
+        auto size = entry.file_size(ec);
+        m_index[key] = Entry{size, 0};
+        m_bytes += size;
+        byAge.emplace_back(entry.last_write_time(ec), key);
+    }
+    std::sort(byAge.begin(), byAge.end());
+    for(auto &entry : byAge) {
+        m_index[entry.second].lastUse = ++m_useCounter;
+    }
+    for(auto &path : staleTemps) {
+        spdlog::debug("Removing stale import cache temp file: {}", path.string());
+        std::filesystem::remove(path, ec);
+    }
+}
+
+gwidi::data::midi::GwidiMidiSnapshot GwidiMidiImportCache::readSnapshot(const char *midiName, const MidiParseOptions &options) {
+    return gwidi::data::midi::GwidiMidiData::snapshot(readFile(midiName, options));
+}
+
+gwidi::data::midi::GwidiMidiSnapshot GwidiMidiImportCache::readSnapshot(const std::uint8_t *data, std::size_t size, const MidiParseOptions &options) {
+    return gwidi::data::midi::GwidiMidiData::snapshot(readFile(data, size, options));
+}
+
+gwidi::data::midi::GwidiMidiData *GwidiMidiImportCache::readFile(const char *midiName, const MidiParseOptions &options) {
+    std::ifstream in(midiName, std::ios::in | std::ios::binary);
+    if(!in.is_open()) {
+        spdlog::warn("Failed to open midi file: {}", midiName);
+    }
+    std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    return readFile(bytes.data(), bytes.size(), options);
+}
+
+gwidi::data::midi::GwidiMidiData *GwidiMidiImportCache::readFile(const std::uint8_t *data, std::size_t size, const MidiParseOptions &options) {
+    auto key = cacheKey(data, size, options);
+    auto path = entryPath(key);
+
+    bool hit;
+    {
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        auto it = m_index.find(key);
+        hit = it != m_index.end() && std::filesystem::exists(path);
+        if(hit) {
+            it->second.lastUse = ++m_useCounter;
+        }
+    }
+
+    if(hit) {
+        // A corrupt entry counts as a miss, it's imported again and overwritten below
+        auto cached = gwidi::data::midi::GwidiMidiData::readFromFile(path);
+        if(cached) {
+            m_hits++;
+            spdlog::debug("Import cache hit: {}", path);
+            // Keep the on-disk LRU order in step for the next run
+            std::error_code ec;
+            std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+            return cached;
+        }
+    }
+
+    m_misses++;
+    spdlog::debug("Import cache miss: {}", path);
+    auto outData = GwidiMidiParser::getInstance().readFile(data, size, options);
+    // A failed decode (missing file, no bytes, no such track) is not cached, it would be served from then on
+    if(!outData || outData->getTracks().empty()) {
+        spdlog::debug("Import produced no tracks, not caching: {}", path);
+        return outData;
+    }
+
+    // Written next to the entry and renamed into place, so readers (and other processes) never see a partial file
+    // Unique per writer, two threads (or processes) importing the same song don't write into one temp file
+    auto writer = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^ std::size_t(std::chrono::steady_clock::now().time_since_epoch().count());
+    auto tempPath = path + "." + std::to_string(writer) + ".tmp";
+    std::error_code ec;
+    std::uintmax_t fileSize = 0;
+    if(!outData->writeToFile(tempPath)) {
+        ec = std::make_error_code(std::errc::io_error);
+    }
+    if(!ec) {
+        fileSize = std::filesystem::file_size(tempPath, ec);
+    }
+    if(!ec) {
+        std::filesystem::rename(tempPath, path, ec);
+    }
+    if(ec) {
+        spdlog::warn("Failed to store import cache entry: {}, {}", path, ec.message());
+        std::error_code removeEc;
+        std::filesystem::remove(tempPath, removeEc);
+        return outData;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        auto &entry = m_index[key];
+        m_bytes -= entry.size;
+        entry.size = fileSize;
+        entry.lastUse = ++m_useCounter;
+        m_bytes += fileSize;
+    }
+    evict();
+    return outData;
+}
+
+void GwidiMidiImportCache::evict() {
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    while(m_bytes > m_maxBytes && !m_index.empty()) {
+        auto oldest = std::min_element(m_index.begin(), m_index.end(), [](const auto &a, const auto &b) {
+            return a.second.lastUse < b.second.lastUse;
+        });
+        std::error_code ec;
+        std::filesystem::remove(entryPath(oldest->first), ec);
+        m_bytes -= oldest->second.size;
+        m_index.erase(oldest);
+        m_evictions++;
+    }
+}
+
+void GwidiMidiImportCache::setMaxBytes(std::uintmax_t maxBytes) {
+    {
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        m_maxBytes = maxBytes;
+    }
+    evict();
+}
+
+void GwidiMidiImportCache::clear() {
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    for(auto &entry : m_index) {
+        std::error_code ec;
+        std::filesystem::remove(entryPath(entry.first), ec);
+    }
+    m_index.clear();
+    m_bytes = 0;
+}
+
+MidiImportCacheStats GwidiMidiImportCache::stats() const {
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    return MidiImportCacheStats{
+            m_hits.load(),
+            m_misses.load(),
+            m_evictions.load(),
+            m_bytes,
+            m_index.size()
+    };
+}
+
+}
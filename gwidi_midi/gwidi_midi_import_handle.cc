@@ -0,0 +1,86 @@
+#include <chrono>
+#include <exception>
+#include "spdlog/spdlog.h"
+#include "gwidi_midi_import_handle.h"
+
+namespace gwidi::midi {
+
+std::shared_ptr<MidiImportHandle> MidiImportHandle::start(Task task) {
+    auto handle = std::shared_ptr<MidiImportHandle>(new MidiImportHandle());
+    // The task only sees a raw pointer, the handle's destructor waits for it to finish
+    auto raw = handle.get();
+    handle->m_result = std::async(std::launch::async, [raw, task = std::move(task)]() {
+        gwidi::data::midi::GwidiMidiData* data = nullptr;
+        try {
+            data = task(*raw);
+        }
+        catch(const std::exception &e) {
+            spdlog::error("Import failed: {}", e.what());
+            raw->m_state = IMPORT_FAILED;
+            return static_cast<gwidi::data::midi::GwidiMidiData*>(nullptr);
+        }
+        catch(...) {
+            spdlog::error("Import failed with an unknown exception");
+            raw->m_state = IMPORT_FAILED;
+            return static_cast<gwidi::data::midi::GwidiMidiData*>(nullptr);
+        }
+        if(!data || raw->m_cancel) {
+            delete data;
+            raw->m_state = IMPORT_CANCELLED;
+            return static_cast<gwidi::data::midi::GwidiMidiData*>(nullptr);
+        }
+        raw->m_state = IMPORT_DONE;
+        return data;
+    });
+    return handle;
+}
+
+MidiImportHandle::~MidiImportHandle() {
+    if(m_result.valid()) {
+        cancel();
+        // Nothing may escape a destructor, the task already catches its own exceptions but get() can still throw
+        try {
+            delete m_result.get();
+        }
+        catch(const std::exception &e) {
+            spdlog::error("Dropped import failed: {}", e.what());
+        }
+        catch(...) {
+            spdlog::error("Dropped import failed with an unknown exception");
+        }
+    }
+}
+
+double MidiImportHandle::progress() const {
+    if(m_state == IMPORT_DONE) {
+        return 1.0;
+    }
+    int total = m_tracksTotal;
+    return total > 0 ? double(m_tracksDone) / total : 0.0;
+}
+
+bool MidiImportHandle::ready() const {
+    return !m_result.valid() || m_result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+gwidi::data::midi::GwidiMidiData *MidiImportHandle::wait() {
+    if(!m_result.valid()) {
+        return nullptr;
+    }
+    return m_result.get();
+}
+
+gwidi::data::midi::GwidiMidiSnapshot MidiImportHandle::waitSnapshot() {
+    return gwidi::data::midi::GwidiMidiData::snapshot(wait());
+}
+
+bool MidiImportHandle::reportTracks(int done, int total) {
+    m_tracksTotal = total;
+    m_tracksDone = done;
+    if(m_cancel) {
+        spdlog::debug("Import cancelled after {} of {} tracks", done, total);
+    }
+    return !m_cancel;
+}
+
+}
@@ -1,186 +1,124 @@
-#include <iostream>
-#include <sstream>
+#include <exception>
+#include <future>
 #include "spdlog/spdlog.h"
 #include "gwidi_midi_parser.h"
+#include "gwidi_midi_document.h"
+#include "gwidi_midi_import_handle.h"
 #include "GwidiMidiData.h"
-#include "MidiFile.h"
-#include "GwidiOptions2.h"
 
 namespace gwidi::midi {
 
-gwidi::data::midi::GwidiMidiData* GwidiMidiParser::readFile(const char* midiName, const MidiParseOptions& options) {
-    auto &instrumentOptions = gwidi::options2::GwidiOptions2::getInstance();   // initialize our instrument mapping
-
-    auto outData = new gwidi::data::midi::GwidiMidiData();
-
-    auto printType = [](smf::MidiEvent &evt) {
-        spdlog::debug("event meta type: {}, as STR: ", evt.getMetaType());
-        if(evt.isNoteOn()) {  spdlog::debug( "NoteOn,"); }
-        if(evt.isInstrumentName()) {  spdlog::debug( "InstrumentName,"); }
-        if(evt.isTempo()) {  spdlog::debug( "Tempo,"); }
-        if(evt.isAftertouch()) {  spdlog::debug( "Aftertouch,"); }
-        if(evt.isController()) {  spdlog::debug( "Controller,"); }
-        if(evt.isCopyright()) {  spdlog::debug( "Copyright,"); }
-        if(evt.isEmpty()) {  spdlog::debug( "Empty,"); }
-        if(evt.isEndOfTrack()) {  spdlog::debug( "EndOfTrack,"); }
-        if(evt.isKeySignature()) {  spdlog::debug( "KeySignature,"); }
-        if(evt.isLyricText()) {  spdlog::debug( "LyricText,"); }
-        if(evt.isMarkerText()) {  spdlog::debug( "MarkerText,"); }
-        if(evt.isMeta()) {  spdlog::debug( "Meta,"); }
-        if(evt.isMetaMessage()) {  spdlog::debug( "MetaMessage,"); }
-        if(evt.isNote()) {  spdlog::debug( "Note,"); }
-        if(evt.isNoteOff()) {  spdlog::debug( "NoteOff,"); }
-        if(evt.isPatchChange()) {  spdlog::debug( "PatchChange,"); }
-        if(evt.isPitchbend()) {  spdlog::debug( "Pitchbend,"); }
-        if(evt.isPressure()) {  spdlog::debug( "Pressure,"); }
-        if(evt.isProgramChange()) {  spdlog::debug( "ProgramChange,"); }
-        if(evt.isSoft()) {  spdlog::debug( "Soft,"); }
-        if(evt.isSoftOff()) {  spdlog::debug( "SoftOff,"); }
-        if(evt.isSoftOn()) {  spdlog::debug( "SoftOn,"); }
-        if(evt.isSustain()) {  spdlog::debug( "Sustain,"); }
-        if(evt.isSustainOff()) {  spdlog::debug( "SustainOff,"); }
-        if(evt.isSustainOn()) {  spdlog::debug( "SustainOn,"); }
-        if(evt.isText()) {  spdlog::debug( "Text,"); }
-        if(evt.isTempo()) {  spdlog::debug( "Tempo,"); }
-        if(evt.isTimbre()) {  spdlog::debug( "Timbre,"); }
-        if(evt.isTimeSignature()) {  spdlog::debug( "TimeSignature,"); }
-        if(evt.isTrackName()) {  spdlog::debug( "TrackName,"); }
-    };
-
-    smf::MidiFile midiFile;
-    midiFile.read(midiName);
-
-    // Some prep for how we plan to use the data
-    midiFile.doTimeAnalysis();
-    auto linkedNotesCount = midiFile.linkNotePairs();
-    spdlog::debug("Linked {} events!", linkedNotesCount);
-
-    auto tc = midiFile.getTrackCount();
-    spdlog::debug("Ticks Per Quarter Note: {}", midiFile.getTicksPerQuarterNote());
-    spdlog::debug("# Tracks: {}", tc);
-
-    for(auto i = 0; i < tc; i++) {
-        spdlog::debug("Track: {}", i);
-        auto &track = midiFile[i];
-        auto ec = track.getEventCount();
-
-        std::vector<gwidi::data::midi::Note> notes;
-        std::string instrument;
-        std::string track_name;
-        double trackDurationInSeconds{0};
-
-        for(auto j = 0; j < ec; j++) {
-            spdlog::debug("Event: {}", j);
-            auto &event = track[j];
-
-            printType(event);
-
-            if(event.isNoteOn()) {
-                std::stringstream eventDetails;
-                spdlog::debug("startSeconds: {}\nnoteOn: {}\nduration: {}\noctave: {}\nnumber: {}\nletter: {}", event.seconds, event.isNoteOn(), event.getDurationInSeconds(), event.getKeyOctave(), event.getKeyNumber(), event.getKeyLetter());
-
-                // When adding a note, determine the 'Note' class variables via our instrumentMapping options
-                // If a note doesn't exist in our mapping, it shouldn't be used
-                auto instrName = options.instrument;
-                auto optionsNote = instrumentOptions.optionsNoteFromMidiNote(instrName, event.getKeyOctave(), event.getKeyLetter());
-                // Use the event if we have a valid mapping for it
-                if(!optionsNote.letters.empty()) {
-                    notes.emplace_back(gwidi::data::midi::Note{
-                            event.seconds,
-                            event.getDurationInSeconds(),
-                            optionsNote.instrument_octave,
-                            event.getKeyLetter(),
-                            "",
-                            i,
-                            optionsNote.key
-                    });
-                }
-            }
-            else if(event.isTempo()) {
-                outData->assignTempo(event.getTempoSeconds(), event.getTempoMicroseconds());
-            }
-            else if(event.isInstrumentName()) {
-                instrument = event.getInstrument();
-            }
-            else if(event.isTrackName()) {
-                track_name = event.getMetaContent();
-            }
-            else if(event.isTimbre()) {
-                instrument = event.getInstrument();
-            }
-            else if(event.isEndOfTrack()) {
-                spdlog::debug("EndOfTrack seconds: {}", event.seconds);
-                trackDurationInSeconds = event.seconds;
-            }
-        }
+namespace {
+
+// Decoding runs to the end, cancellation is checked before and between the tracks
+gwidi::data::midi::GwidiMidiData* convertWithProgress(MidiImportHandle &handle, const MidiDocument &doc, const std::vector<MidiParseOptions> &trackOptions) {
+    if(!handle.reportTracks(0, int(trackOptions.size()))) {
+        return nullptr;
+    }
+    return doc.convertTracks(trackOptions, 0, [&handle](int done, int total) {
+        return handle.reportTracks(done, total);
+    });
+}
+
+// Owns the producer of a streaming import, the consumers' stream references keep it alive
+// The producer only holds the stream itself, so dropping the last consumer reference ends up here
+struct StreamingImport {
+    std::shared_ptr<gwidi::data::midi::GwidiMidiStream> stream;
+    std::future<void> producer;
 
-        // This is still required down here because we do other things with track 1 (like assign tempo)
-        if(i != options.chosen_track) {
-            spdlog::debug("Skipping track: {}, chosen_track: {}", i, options.chosen_track);
-            continue;
+    ~StreamingImport() {
+        stream->cancel();
+        if(producer.valid()) {
+            producer.wait();
         }
-        outData->addTrack(instrument, track_name, notes, trackDurationInSeconds);
     }
+};
 
-    outData->fillTickMap();
-    return outData;
 }
 
-// Used to let users choose which track to pick when midi importing (passed in MidiParseOptions)
-GwidiMidiParser::TrackMeta GwidiMidiParser::getTrackMetaMap(const char *midiName) {
-    TrackMeta ret;
-
-    smf::MidiFile midiFile;
-    midiFile.read(midiName);
-
-    // Some prep for how we plan to use the data
-    midiFile.doTimeAnalysis();
-    auto linkedNotesCount = midiFile.linkNotePairs();
-    spdlog::debug("Linked {} events!", linkedNotesCount);
-
-    auto tc = midiFile.getTrackCount();
-    spdlog::debug("Ticks Per Quarter Note: {}", midiFile.getTicksPerQuarterNote());
-    spdlog::debug("# Tracks: {}", tc);
-
-    for(auto i = 0; i < tc; i++) {
-        ret[i] = MidiParseTrackStats{};
-        ret[i].num_notes = 0;
-
-        spdlog::debug("Track: {}", i);
-        auto &track = midiFile[i];
-        auto ec = track.getEventCount();
-
-        for(auto j = 0; j < ec; j++) {
-            spdlog::debug("Event: {}", j);
-            auto &event = track[j];
-
-            if(event.isNoteOn()) {
-                ret[i].num_notes++;
-            }
-            else if(event.isTempo()) {
-                ret[i].tempo = event.getTempoSeconds();
-            }
-            else if(event.isInstrumentName()) {
-                if(ret[i].instrument.empty()) {
-                    ret[i].instrument = event.getInstrument();
-                }
-            }
-            else if(event.isTrackName()) {
-                ret[i].name = event.getMetaContent();
-            }
-            else if(event.isTimbre()) {
-                if(ret[i].instrument.empty()) {
-                    ret[i].instrument = event.getInstrument();
-                }
-            }
-            else if(event.isEndOfTrack()) {
-                ret[i].duration = event.seconds;
-            }
-        }
+std::shared_ptr<MidiDocument> GwidiMidiParser::openDocument(const char *midiName, MidiReadMode mode) {
+    if(mode == READ_MAPPED) {
+        return MidiDocument::openMapped(midiName);
     }
+    return MidiDocument::open(midiName);
+}
+
+std::shared_ptr<MidiDocument> GwidiMidiParser::openDocument(const std::uint8_t *data, std::size_t size) {
+    return MidiDocument::open(data, size);
+}
+
+gwidi::data::midi::GwidiMidiSnapshot GwidiMidiParser::readSnapshot(const char* midiName, const MidiParseOptions& options, MidiReadMode mode) {
+    return gwidi::data::midi::GwidiMidiData::snapshot(readFile(midiName, options, mode));
+}
+
+gwidi::data::midi::GwidiMidiSnapshot GwidiMidiParser::readSnapshot(const std::uint8_t *data, std::size_t size, const MidiParseOptions &options) {
+    return gwidi::data::midi::GwidiMidiData::snapshot(readFile(data, size, options));
+}
+
+gwidi::data::midi::GwidiMidiSnapshot GwidiMidiParser::readTracksSnapshot(const char *midiName, const std::vector<MidiParseOptions> &trackOptions, MidiReadMode mode) {
+    return gwidi::data::midi::GwidiMidiData::snapshot(readTracks(midiName, trackOptions, mode));
+}
+
+gwidi::data::midi::GwidiMidiData* GwidiMidiParser::readFile(const char* midiName, const MidiParseOptions& options, MidiReadMode mode) {
+    return openDocument(midiName, mode)->convert(options);
+}
 
-    return ret;
+gwidi::data::midi::GwidiMidiData* GwidiMidiParser::readFile(const std::uint8_t *data, std::size_t size, const MidiParseOptions &options) {
+    return openDocument(data, size)->convert(options);
 }
 
+gwidi::data::midi::GwidiMidiData* GwidiMidiParser::readTracks(const char *midiName, const std::vector<MidiParseOptions> &trackOptions, MidiReadMode mode) {
+    return openDocument(midiName, mode)->convertTracks(trackOptions);
 }
 
+std::shared_ptr<MidiImportHandle> GwidiMidiParser::readFileAsync(const std::string &midiName, const MidiParseOptions &options, MidiReadMode mode) {
+    return readTracksAsync(midiName, {options}, mode);
+}
+
+std::shared_ptr<MidiImportHandle> GwidiMidiParser::readFileAsync(std::vector<std::uint8_t> bytes, const MidiParseOptions &options) {
+    return MidiImportHandle::start([bytes = std::move(bytes), options](MidiImportHandle &handle) {
+        auto doc = MidiDocument::open(bytes.data(), bytes.size());
+        return convertWithProgress(handle, *doc, {options});
+    });
+}
+
+std::shared_ptr<MidiImportHandle> GwidiMidiParser::readTracksAsync(const std::string &midiName, const std::vector<MidiParseOptions> &trackOptions, MidiReadMode mode) {
+    return MidiImportHandle::start([midiName, trackOptions, mode](MidiImportHandle &handle) {
+        auto doc = GwidiMidiParser::getInstance().openDocument(midiName.c_str(), mode);
+        return convertWithProgress(handle, *doc, trackOptions);
+    });
+}
+
+std::shared_ptr<gwidi::data::midi::GwidiMidiStream> GwidiMidiParser::readFileStreaming(const std::string &midiName, const MidiParseOptions &options, MidiReadMode mode) {
+    auto import = std::make_shared<StreamingImport>();
+    import->stream = std::make_shared<gwidi::data::midi::GwidiMidiStream>();
+    import->producer = std::async(std::launch::async, [stream = import->stream, midiName, options, mode]() {
+        // A failed import still finishes the stream, waiters on the watermark would hang otherwise
+        try {
+            auto doc = GwidiMidiParser::getInstance().openDocument(midiName.c_str(), mode);
+            doc->streamTrack(options, *stream);
+        }
+        catch(const std::exception &e) {
+            spdlog::error("Streaming import failed: {}", e.what());
+            stream->finish(stream->watermark());
+        }
+        catch(...) {
+            spdlog::error("Streaming import failed with an unknown exception");
+            stream->finish(stream->watermark());
+        }
+    });
+    // Shares ownership with the import, the stream handed out is the one the producer fills
+    return std::shared_ptr<gwidi::data::midi::GwidiMidiStream>(import, import->stream.get());
+}
+
+// Used to let users choose which track to pick when midi importing (passed in MidiParseOptions)
+// Skimmed, the stats don't need the notes themselves
+GwidiMidiParser::TrackMeta GwidiMidiParser::getTrackMetaMap(const char *midiName, MidiReadMode mode) {
+    return MidiDocument::skimTrackMeta(midiName, mode);
+}
+
+GwidiMidiParser::TrackMeta GwidiMidiParser::getTrackMetaMap(const std::uint8_t *data, std::size_t size) {
+    return MidiDocument::skimTrackMeta(data, size);
+}
+
+}
@@ -0,0 +1,380 @@
+#include <array>
+#include <algorithm>
+#include "spdlog/spdlog.h"
+#include "gwidi_smf_decoder.h"
+
+namespace gwidi::midi {
+
+namespace {
+
+const char* s_keyLetters[12] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+
+// General MIDI program names, used for tracks that only carry a program change
+const char* s_programNames[128] = {
+        "Acoustic Grand Piano", "Bright Acoustic Piano", "Electric Grand Piano", "Honky-tonk Piano",
+        "Electric Piano 1", "Electric Piano 2", "Harpsichord", "Clavinet",
+        "Celesta", "Glockenspiel", "Music Box", "Vibraphone",
+        "Marimba", "Xylophone", "Tubular Bells", "Dulcimer",
+        "Drawbar Organ", "Percussive Organ", "Rock Organ", "Church Organ",
+        "Reed Organ", "Accordion", "Harmonica", "Tango Accordion",
+        "Acoustic Guitar (nylon)", "Acoustic Guitar (steel)", "Electric Guitar (jazz)", "Electric Guitar (clean)",
+        "Electric Guitar (muted)", "Overdriven Guitar", "Distortion Guitar", "Guitar Harmonics",
+        "Acoustic Bass", "Electric Bass (finger)", "Electric Bass (pick)", "Fretless Bass",
+        "Slap Bass 1", "Slap Bass 2", "Synth Bass 1", "Synth Bass 2",
+        "Violin", "Viola", "Cello", "Contrabass",
+        "Tremolo Strings", "Pizzicato Strings", "Orchestral Harp", "Timpani",
+        "String Ensemble 1", "String Ensemble 2", "Synth Strings 1", "Synth Strings 2",
+        "Choir Aahs", "Voice Oohs", "Synth Voice", "Orchestra Hit",
+        "Trumpet", "Trombone", "Tuba", "Muted Trumpet",
+        "French Horn", "Brass Section", "Synth Brass 1", "Synth Brass 2",
+        "Soprano Sax", "Alto Sax", "Tenor Sax", "Baritone Sax",
+        "Oboe", "English Horn", "Bassoon", "Clarinet",
+        "Piccolo", "Flute", "Recorder", "Pan Flute",
+        "Blown Bottle", "Shakuhachi", "Whistle", "Ocarina",
+        "Lead 1 (square)", "Lead 2 (sawtooth)", "Lead 3 (calliope)", "Lead 4 (chiff)",
+        "Lead 5 (charang)", "Lead 6 (voice)", "Lead 7 (fifths)", "Lead 8 (bass + lead)",
+        "Pad 1 (new age)", "Pad 2 (warm)", "Pad 3 (polysynth)", "Pad 4 (choir)",
+        "Pad 5 (bowed)", "Pad 6 (metallic)", "Pad 7 (halo)", "Pad 8 (sweep)",
+        "FX 1 (rain)", "FX 2 (soundtrack)", "FX 3 (crystal)", "FX 4 (atmosphere)",
+        "FX 5 (brightness)", "FX 6 (goblins)", "FX 7 (echoes)", "FX 8 (sci-fi)",
+        "Sitar", "Banjo", "Shamisen", "Koto",
+        "Kalimba", "Bagpipe", "Fiddle", "Shanai",
+        "Tinkle Bell", "Agogo", "Steel Drums", "Woodblock",
+        "Taiko Drum", "Melodic Tom", "Synth Drum", "Reverse Cymbal",
+        "Guitar Fret Noise", "Breath Noise", "Seashore", "Bird Tweet",
+        "Telephone Ring", "Helicopter", "Applause", "Gunshot"
+};
+
+class ByteReader {
+public:
+    ByteReader(const std::uint8_t* begin, const std::uint8_t* end) : m_p{begin}, m_end{end} {}
+
+    inline bool has(std::size_t n) const {
+        return std::size_t(m_end - m_p) >= n;
+    }
+    inline bool atEnd() const {
+        return m_p >= m_end;
+    }
+    inline const std::uint8_t* pos() const {
+        return m_p;
+    }
+    inline std::uint8_t peek() const {
+        return *m_p;
+    }
+    inline std::uint8_t u8() {
+        return *m_p++;
+    }
+    inline std::uint32_t be16() {
+        std::uint32_t v = (std::uint32_t(m_p[0]) << 8) | m_p[1];
+        m_p += 2;
+        return v;
+    }
+    inline std::uint32_t be32() {
+        std::uint32_t v = (std::uint32_t(m_p[0]) << 24) | (std::uint32_t(m_p[1]) << 16) | (std::uint32_t(m_p[2]) << 8) | m_p[3];
+        m_p += 4;
+        return v;
+    }
+    // Variable length quantity, at most 4 bytes
+    inline bool varlen(std::uint32_t &out) {
+        out = 0;
+        for(auto i = 0; i < 4; i++) {
+            if(atEnd()) {
+                return false;
+            }
+            auto c = *m_p++;
+            out = (out << 7) | (c & 0x7F);
+            if(!(c & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    inline void skip(std::size_t n) {
+        m_p += n;
+    }
+
+private:
+    const std::uint8_t* m_p;
+    const std::uint8_t* m_end;
+};
+
+// Decodes one MTrk chunk, pairing note-ons to their note-offs as it goes (last opened note of a key/channel first)
+// Skim only counts the note-ons, nothing is allocated per note
+// Returns false when the track is malformed, track holds what was read up to that point
+template<bool Skim>
+bool decodeTrack(ByteReader reader, SmfTrack &track, std::vector<SmfTempoChange> &tempos, double &lastTempoMicro) {
+    std::array<std::int32_t, 16 * 128> openHead{};
+    openHead.fill(-1);
+    std::vector<std::int32_t> openLink;     // previous open note of the same key/channel, parallel to track.notes
+    std::array<std::uint8_t, 16> programs{};
+    track.channel_programs.fill(-1);
+
+    std::int64_t tick = 0;
+    std::uint8_t running = 0;
+    bool endSeen = false;
+    bool ok = true;
+
+    while(!reader.atEnd()) {
+        std::uint32_t delta;
+        if(!reader.varlen(delta) || reader.atEnd()) {
+            spdlog::warn("SmfDecoder: truncated event in track, stopping at tick {}", tick);
+            ok = false;
+            break;
+        }
+        tick += delta;
+
+        std::uint8_t status = reader.peek();
+        if(status & 0x80) {
+            reader.u8();
+        }
+        else if(running) {
+            status = running;
+        }
+        else {
+            spdlog::warn("SmfDecoder: data byte without running status at tick {}", tick);
+            ok = false;
+            break;
+        }
+
+        // Meta and sysex events cancel running status, a data byte right after one has no status to reuse
+        if(status == 0xFF) {
+            running = 0;
+            std::uint32_t len;
+            if(!reader.has(1)) {
+                spdlog::warn("SmfDecoder: truncated meta event at tick {}", tick);
+                ok = false;
+                break;
+            }
+            auto type = reader.u8();
+            if(!reader.varlen(len) || !reader.has(len)) {
+                spdlog::warn("SmfDecoder: truncated meta event at tick {}", tick);
+                ok = false;
+                break;
+            }
+            auto metaData = reader.pos();
+            reader.skip(len);
+
+            switch(type) {
+                case 0x51: {
+                    if(len >= 3) {
+                        double micro = (std::uint32_t(metaData[0]) << 16) | (std::uint32_t(metaData[1]) << 8) | metaData[2];
+                        // A 0 microsecond quarter note has no meaning (and would divide by zero later), it is skipped
+                        if(micro == 0) {
+                            break;
+                        }
+                        tempos.emplace_back(SmfTempoChange{tick, micro});
+                        track.tempo = micro / 1000000.0;
+                        lastTempoMicro = micro;
+                    }
+                    break;
+                }
+                case 0x03: {
+                    track.name.assign(reinterpret_cast<const char*>(metaData), len);
+                    break;
+                }
+                case 0x04: {
+                    track.instrument.assign(reinterpret_cast<const char*>(metaData), len);
+                    if(track.first_instrument.empty()) {
+                        track.first_instrument = track.instrument;
+                    }
+                    break;
+                }
+                case 0x2F: {
+                    endSeen = true;
+                    break;
+                }
+                default:
+                    break;
+            }
+            if(endSeen) {
+                break;
+            }
+            continue;
+        }
+
+        if(status == 0xF0 || status == 0xF7) {
+            running = 0;
+            std::uint32_t len;
+            if(!reader.varlen(len) || !reader.has(len)) {
+                spdlog::warn("SmfDecoder: truncated sysex event at tick {}", tick);
+                ok = false;
+                break;
+            }
+            reader.skip(len);
+            continue;
+        }
+
+        // System common / real-time messages (0xF1-0xFE) are not valid in a file, their length isn't known here either
+        if(status > 0xF0) {
+            spdlog::warn("SmfDecoder: system status {:#x} in track data at tick {}", status, tick);
+            ok = false;
+            break;
+        }
+
+        running = status;
+        auto channel = status & 0x0F;
+        auto kind = status & 0xF0;
+        std::size_t dataBytes = (kind == 0xC0 || kind == 0xD0) ? 1 : 2;
+        if(!reader.has(dataBytes)) {
+            spdlog::warn("SmfDecoder: truncated channel event at tick {}", tick);
+            ok = false;
+            break;
+        }
+
+        switch(kind) {
+            case 0x90: {
+                auto key = reader.u8() & 0x7F;
+                auto velocity = reader.u8() & 0x7F;
+                if(Skim) {
+                    track.num_note_ons += velocity > 0;
+                    track.channel_note_ons[channel] += velocity > 0;
+                    break;
+                }
+                if(velocity > 0) {
+                    auto slot = channel * 128 + key;
+                    SmfNote note;
+                    note.start_tick = tick;
+                    note.key = key;
+                    note.channel = channel;
+                    note.velocity = velocity;
+                    note.program = programs[channel];
+                    openLink.emplace_back(openHead[slot]);
+                    openHead[slot] = std::int32_t(track.notes.size());
+                    track.notes.emplace_back(note);
+                    track.num_note_ons++;
+                    track.channel_note_ons[channel]++;
+                    break;
+                }
+                // velocity 0 note-on is a note-off
+                auto slot = channel * 128 + key;
+                auto open = openHead[slot];
+                if(open >= 0) {
+                    track.notes[open].end_tick = tick;
+                    openHead[slot] = openLink[open];
+                }
+                break;
+            }
+            case 0x80: {
+                if(Skim) {
+                    reader.skip(2);
+                    break;
+                }
+                auto key = reader.u8() & 0x7F;
+                reader.u8();
+                auto slot = channel * 128 + key;
+                auto open = openHead[slot];
+                if(open >= 0) {
+                    track.notes[open].end_tick = tick;
+                    openHead[slot] = openLink[open];
+                }
+                break;
+            }
+            case 0xC0: {
+                auto program = reader.u8() & 0x7F;
+                programs[channel] = program;
+                if(track.channel_programs[channel] == -1) {
+                    track.channel_programs[channel] = program;
+                }
+                track.instrument = SmfDecoder::programName(program);
+                if(track.first_instrument.empty()) {
+                    track.first_instrument = track.instrument;
+                }
+                break;
+            }
+            default:
+                reader.skip(dataBytes);
+                break;
+        }
+    }
+    track.end_tick = tick;
+    return ok;
+}
+
+}
+
+const char* SmfDecoder::keyLetter(int key) {
+    return s_keyLetters[((key % 12) + 12) % 12];
+}
+
+const char* SmfDecoder::programName(int program) {
+    return s_programNames[program & 0x7F];
+}
+
+bool SmfDecoder::decode(const std::uint8_t *data, std::size_t size, SmfData &out, SmfDecodeMode mode) {
+    out = SmfData{};
+    if(!data) {
+        return false;
+    }
+
+    ByteReader reader(data, data + size);
+    if(!reader.has(14) || std::string(reinterpret_cast<const char*>(data), 4) != "MThd") {
+        spdlog::warn("SmfDecoder: missing MThd header");
+        return false;
+    }
+    reader.skip(4);
+    auto headerLength = reader.be32();
+    if(headerLength < 6 || !reader.has(headerLength)) {
+        spdlog::warn("SmfDecoder: invalid header length: {}", headerLength);
+        return false;
+    }
+    out.format = int(reader.be16());
+    auto trackCount = reader.be16();
+    auto division = std::int16_t(reader.be16());
+    reader.skip(headerLength - 6);
+    out.ticks_per_quarter = division > 0 ? division : 0;
+
+    spdlog::debug("SmfDecoder: format: {}, # Tracks: {}, division: {}", out.format, trackCount, division);
+
+    double lastTempoMicro = 0.0;
+    bool complete = true;
+    out.tracks.reserve(trackCount);
+    while(out.tracks.size() < trackCount && reader.has(8)) {
+        bool isTrack = std::string(reinterpret_cast<const char*>(reader.pos()), 4) == "MTrk";
+        reader.skip(4);
+        std::size_t chunkLength = reader.be32();
+        if(!reader.has(chunkLength)) {
+            spdlog::warn("SmfDecoder: chunk overruns the file, reading what is there");
+            chunkLength = std::size_t(data + size - reader.pos());
+        }
+        if(isTrack) {
+            out.tracks.emplace_back();
+            ByteReader trackReader(reader.pos(), reader.pos() + chunkLength);
+            auto trackOk = mode == DECODE_SKIM
+                    ? decodeTrack<true>(trackReader, out.tracks.back(), out.tempos, lastTempoMicro)
+                    : decodeTrack<false>(trackReader, out.tracks.back(), out.tempos, lastTempoMicro);
+            if(!trackOk) {
+                spdlog::warn("SmfDecoder: track {} is malformed, not reading further tracks", out.tracks.size() - 1);
+                complete = false;
+                break;
+            }
+        }
+        reader.skip(chunkLength);
+    }
+
+    if(lastTempoMicro > 0) {
+        out.tempo = lastTempoMicro / 1000000.0;
+        out.tempo_micro = lastTempoMicro;
+    }
+
+    // Resolve ticks to seconds, tempo changes from every track apply to all of them
+    // A skim has no notes, so only the track ends go through the tempo map
+    std::stable_sort(out.tempos.begin(), out.tempos.end(), [](const SmfTempoChange &a, const SmfTempoChange &b) {
+        return a.tick < b.tick;
+    });
+    if(division < 0) {
+        out.tempo_map = gwidi::data::midi::TempoMap::fromSmpte(-(division >> 8), division & 0xFF);
+    }
+    else {
+        out.tempo_map = gwidi::data::midi::TempoMap(out.ticks_per_quarter, out.tempos);
+    }
+    for(auto &track : out.tracks) {
+        for(auto &note : track.notes) {
+            note.start_seconds = out.tempo_map.secondsAtTick(note.start_tick);
+            note.duration_seconds = note.end_tick >= 0 ? out.tempo_map.secondsAtTick(note.end_tick) - note.start_seconds : 0.0;
+        }
+        track.end_seconds = out.tempo_map.secondsAtTick(track.end_tick);
+    }
+    return complete;
+}
+
+}
@@ -0,0 +1,108 @@
+#include <istream>
+#include <algorithm>
+#include <streambuf>
+#include "spdlog/spdlog.h"
+#include "gwidi_smf_decoder.h"
+#include "MidiFile.h"
+
+namespace gwidi::midi {
+
+namespace {
+
+// Lets the midifile stream reader consume bytes that are already in memory, without copying them
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const std::uint8_t* data, std::size_t size) {
+        auto begin = reinterpret_cast<char*>(const_cast<std::uint8_t*>(data));
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        char* target = dir == std::ios_base::beg ? eback() + off : (dir == std::ios_base::cur ? gptr() + off : egptr() + off);
+        if(target < eback() || target > egptr()) {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), target, egptr());
+        return pos_type(target - eback());
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+}
+
+bool SmfDecoder::decodeWithMidifile(const std::uint8_t *data, std::size_t size, SmfData &out) {
+    out = SmfData{};
+    if(!data || size == 0) {
+        return false;
+    }
+
+    smf::MidiFile midiFile;
+    MemoryStreamBuf buf(data, size);
+    std::istream in(&buf);
+    if(!midiFile.read(in)) {
+        spdlog::warn("midifile failed to read the given data");
+        return false;
+    }
+
+    // Some prep for how we plan to use the data
+    midiFile.doTimeAnalysis();
+    auto linkedNotesCount = midiFile.linkNotePairs();
+    spdlog::debug("Linked {} events!", linkedNotesCount);
+
+    out.ticks_per_quarter = midiFile.getTicksPerQuarterNote();
+    auto tc = midiFile.getTrackCount();
+    for(auto i = 0; i < tc; i++) {
+        out.tracks.emplace_back();
+        auto &track = out.tracks.back();
+        track.channel_programs.fill(-1);
+        auto &events = midiFile[i];
+        auto ec = events.getEventCount();
+        for(auto j = 0; j < ec; j++) {
+            auto &event = events[j];
+            if(event.isNoteOn()) {
+                SmfNote note;
+                note.start_tick = event.tick;
+                note.start_seconds = event.seconds;
+                note.duration_seconds = event.getDurationInSeconds();
+                note.key = event.getKeyNumber();
+                note.channel = event.getChannel();
+                track.notes.emplace_back(note);
+                track.num_note_ons++;
+                track.channel_note_ons[note.channel]++;
+            }
+            else if(event.isPatchChange() && track.channel_programs[event.getChannel()] == -1) {
+                track.channel_programs[event.getChannel()] = event.getP1();
+            }
+            else if(event.isTempo() && event.getTempoMicroseconds() > 0) {
+                track.tempo = event.getTempoSeconds();
+                out.tempo = event.getTempoSeconds();
+                out.tempo_micro = event.getTempoMicroseconds();
+                out.tempos.emplace_back(SmfTempoChange{event.tick, event.getTempoMicroseconds()});
+            }
+            else if(event.isInstrumentName() || event.isTimbre()) {
+                track.instrument = event.getInstrument();
+                if(track.first_instrument.empty()) {
+                    track.first_instrument = track.instrument;
+                }
+            }
+            else if(event.isTrackName()) {
+                track.name = event.getMetaContent();
+            }
+            else if(event.isEndOfTrack()) {
+                track.end_tick = event.tick;
+                track.end_seconds = event.seconds;
+            }
+        }
+    }
+    std::stable_sort(out.tempos.begin(), out.tempos.end(), [](const SmfTempoChange &a, const SmfTempoChange &b) {
+        return a.tick < b.tick;
+    });
+    out.tempo_map = gwidi::data::midi::TempoMap(out.ticks_per_quarter, out.tempos);
+    return true;
+}
+
+}
@@ -0,0 +1,55 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDI_MIDI_BATCH_H
+#define GWIDI_MIDI_PARSER_GWIDI_MIDI_BATCH_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "gwidi_midi_parser.h"
+
+namespace gwidi::midi {
+
+// Which track(s) of each midi file end up in its .gwd
+enum MidiBatchTrackSelect {
+    SELECT_TRACK_INDEX = 0,     // MidiBatchOptions::chosen_track
+    SELECT_MOST_NOTES = 1,      // the track with the most note ons
+    SELECT_ALL_TRACKS = 2       // every track with notes, merged into one GwidiMidiData
+};
+
+struct MidiBatchOptions {
+    std::string input_dir;
+    std::string output_dir;
+    std::vector<std::string> instruments{"default"};   // one .gwd per instrument per midi file
+    MidiBatchTrackSelect track_select{SELECT_MOST_NOTES};
+    int chosen_track{0};
+    bool recursive{false};          // walk sub directories too, outputs mirror the directory layout
+    unsigned int thread_count{0};   // 0 uses the hardware concurrency
+};
+
+struct MidiBatchFileResult {
+    std::string input;
+    std::vector<std::string> outputs;
+    std::string error;      // empty on success
+    double decode_ms{0};
+    double convert_ms{0};
+    double write_ms{0};
+
+    inline bool ok() const {
+        return error.empty();
+    }
+};
+
+// Converts a whole directory of .mid files to .gwd, one file per worker at a time
+// Output names are <output_dir>/<relative dir>/<midi file name>.<instrument>.gwd, extension included (song.mid.default.gwd)
+class GwidiMidiBatchImporter {
+public:
+    // Called from the worker threads as each file finishes
+    using FileDoneCallback = std::function<void(const MidiBatchFileResult&)>;
+
+    // Results are in sorted input path order, regardless of which worker handled them
+    static std::vector<MidiBatchFileResult> run(const MidiBatchOptions& options, const FileDoneCallback& onFileDone = {});
+    static MidiBatchFileResult importFile(const std::string& midiPath, const MidiBatchOptions& options);
+};
+
+}
+
+#endif //GWIDI_MIDI_PARSER_GWIDI_MIDI_BATCH_H
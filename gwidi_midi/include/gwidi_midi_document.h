@@ -0,0 +1,83 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDI_MIDI_DOCUMENT_H
+#define GWIDI_MIDI_PARSER_GWIDI_MIDI_DOCUMENT_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "gwidi_midi_parser.h"
+#include "gwidi_smf_decoder.h"
+
+namespace gwidi::options2 {
+class MidiNoteLookup;
+}
+
+namespace gwidi::data::midi {
+class GwidiMidiStream;
+}
+
+namespace gwidi::midi {
+
+// A midi file that has been decoded once
+// Track stats and conversions to GwidiMidiData are served from the same decode, so picking a different
+// chosen_track / instrument only costs the conversion of that track
+class MidiDocument {
+public:
+    static std::shared_ptr<MidiDocument> open(const char* midiName);
+    // Decodes straight out of the given bytes, they are not kept past this call
+    static std::shared_ptr<MidiDocument> open(const std::uint8_t* data, std::size_t size);
+    static std::shared_ptr<MidiDocument> openMapped(const char* midiName);
+
+    // Track listing without a document, the file is skimmed (no note pairing or per-note times)
+    static GwidiMidiParser::TrackMeta skimTrackMeta(const char* midiName, MidiReadMode mode = READ_STREAM);
+    static GwidiMidiParser::TrackMeta skimTrackMeta(const std::uint8_t* data, std::size_t size);
+
+    inline const GwidiMidiParser::TrackMeta& getTrackMetaMap() const {
+        return m_trackMeta;
+    }
+
+    inline const SmfData& getData() const {
+        return m_data;
+    }
+
+    int trackCount() const;
+    gwidi::data::midi::GwidiMidiData* convert(const MidiParseOptions& options) const;
+
+    // Called (from the workers) with (tracks converted, tracks requested) after every track, return false to stop
+    // before the next one
+    using ProgressCallback = std::function<bool(int, int)>;
+
+    // Converts several tracks at once on a pool of worker threads, each with its own instrument mapping
+    // Tracks land in GwidiMidiData::tracks in the order of trackOptions, threadCount == 0 uses the hardware concurrency
+    // nullptr when onProgress stopped the conversion
+    gwidi::data::midi::GwidiMidiData* convertTracks(const std::vector<MidiParseOptions>& trackOptions, unsigned int threadCount = 0, const ProgressCallback& onProgress = {}) const;
+    gwidi::data::midi::GwidiMidiData* convertAllTracks(const std::string& instrument, unsigned int threadCount = 0) const;
+    // Every channel that plays notes in the track becomes its own Track (type 0 files), in channel order
+    gwidi::data::midi::GwidiMidiData* convertAllChannels(int track, const std::string& instrument, unsigned int threadCount = 0) const;
+
+    // Converts one track into the stream notesPerChunk notes at a time, in time order, then finishes the stream
+    // Checks GwidiMidiStream::cancelled() between chunks
+    void streamTrack(const MidiParseOptions& options, gwidi::data::midi::GwidiMidiStream& stream, std::size_t notesPerChunk = 64) const;
+
+private:
+    struct ConvertedTrack {
+        std::vector<gwidi::data::midi::Note> notes;
+        std::string instrument;
+        std::string track_name;
+        double durationInSeconds{0};
+    };
+
+    MidiDocument() = default;
+    static void analyzeTracks(const SmfData& data, GwidiMidiParser::TrackMeta& trackMeta);
+    // slot is where the track ends up in the converted data
+    void convertTrack(const MidiParseOptions& options, int slot, ConvertedTrack& out) const;
+    // The notes [begin, end) of options.chosen_track that the instrument can play
+    // Their Note::track is slot, whole tracks and channels split off alike
+    void convertNotes(const MidiParseOptions& options, int slot, const gwidi::options2::MidiNoteLookup* lookup, std::size_t begin, std::size_t end, std::vector<gwidi::data::midi::Note>& out) const;
+
+    SmfData m_data;
+    GwidiMidiParser::TrackMeta m_trackMeta;
+};
+
+}
+
+#endif //GWIDI_MIDI_PARSER_GWIDI_MIDI_DOCUMENT_H
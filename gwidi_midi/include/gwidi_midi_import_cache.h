@@ -0,0 +1,66 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDI_MIDI_IMPORT_CACHE_H
+#define GWIDI_MIDI_PARSER_GWIDI_MIDI_IMPORT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include "gwidi_midi_parser.h"
+
+namespace gwidi::midi {
+
+struct MidiImportCacheStats {
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t evictions{0};
+    std::uintmax_t bytes{0};
+    std::size_t entries{0};
+};
+
+// On-disk cache of converted midi imports, stored as .gwd files
+// Entries are keyed by a hash of the midi bytes, the MidiParseOptions and the instrument config, so editing
+// config/instruments/*.json invalidates them once the config is rebuilt (GwidiOptions2::configFingerprint).
+// Imports that produce no tracks are not stored. The least recently used entries are evicted past maxBytes.
+class GwidiMidiImportCache {
+public:
+    GwidiMidiImportCache(std::string cacheDir, std::uintmax_t maxBytes);
+
+    gwidi::data::midi::GwidiMidiSnapshot readSnapshot(const char* midiName, const MidiParseOptions& options);
+    gwidi::data::midi::GwidiMidiSnapshot readSnapshot(const std::uint8_t* data, std::size_t size, const MidiParseOptions& options);
+    // Deprecated, the caller owns the returned data and has to delete it, use readSnapshot
+    gwidi::data::midi::GwidiMidiData* readFile(const char* midiName, const MidiParseOptions& options);
+    gwidi::data::midi::GwidiMidiData* readFile(const std::uint8_t* data, std::size_t size, const MidiParseOptions& options);
+
+    void setMaxBytes(std::uintmax_t maxBytes);
+    void clear();
+    MidiImportCacheStats stats() const;
+
+    static std::uint64_t cacheKey(const std::uint8_t* data, std::size_t size, const MidiParseOptions& options);
+
+private:
+    struct Entry {
+        std::uintmax_t size{0};
+        std::uint64_t lastUse{0};
+    };
+
+    std::string entryPath(std::uint64_t key) const;
+    void loadIndex();
+    void evict();
+
+    std::string m_cacheDir;
+    std::uintmax_t m_maxBytes;
+
+    mutable std::mutex m_indexMutex;
+    std::map<std::uint64_t, Entry> m_index;
+    std::uintmax_t m_bytes{0};
+    std::uint64_t m_useCounter{0};
+
+    std::atomic<std::uint64_t> m_hits{0};
+    std::atomic<std::uint64_t> m_misses{0};
+    std::atomic<std::uint64_t> m_evictions{0};
+};
+
+}
+
+#endif //GWIDI_MIDI_PARSER_GWIDI_MIDI_IMPORT_CACHE_H
@@ -0,0 +1,79 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDI_MIDI_IMPORT_HANDLE_H
+#define GWIDI_MIDI_PARSER_GWIDI_MIDI_IMPORT_HANDLE_H
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include "GwidiMidiData.h"
+
+namespace gwidi::midi {
+
+enum MidiImportState {
+    IMPORT_RUNNING = 0,
+    IMPORT_DONE = 1,
+    IMPORT_CANCELLED = 2,
+    IMPORT_FAILED = 3       // the import task threw, the error is logged
+};
+
+// A midi import running on a background thread
+// Poll it from the UI thread (progress(), ready()), then collect the data with waitSnapshot()
+// Dropping the handle cancels the import and waits for the worker to stop
+class MidiImportHandle {
+public:
+    using Task = std::function<gwidi::data::midi::GwidiMidiData*(MidiImportHandle&)>;
+
+    static std::shared_ptr<MidiImportHandle> start(Task task);
+    ~MidiImportHandle();
+
+    MidiImportHandle(const MidiImportHandle&) = delete;
+    MidiImportHandle& operator=(const MidiImportHandle&) = delete;
+
+    // Cooperative, the import stops before its next track
+    inline void cancel() {
+        m_cancel = true;
+    }
+
+    inline bool cancelRequested() const {
+        return m_cancel;
+    }
+
+    inline MidiImportState state() const {
+        return m_state;
+    }
+
+    inline int tracksDone() const {
+        return m_tracksDone;
+    }
+
+    // 0 until the midi file is decoded
+    inline int tracksTotal() const {
+        return m_tracksTotal;
+    }
+
+    // 0.0 - 1.0
+    double progress() const;
+    bool ready() const;
+
+    // Blocks until the import finishes
+    // Empty when the import was cancelled, failed or the data was already taken
+    gwidi::data::midi::GwidiMidiSnapshot waitSnapshot();
+    // Deprecated, the caller owns the returned data and has to delete it, use waitSnapshot
+    gwidi::data::midi::GwidiMidiData* wait();
+
+    // For the import task, records progress and returns false once cancelled
+    bool reportTracks(int done, int total);
+
+private:
+    MidiImportHandle() = default;
+
+    std::future<gwidi::data::midi::GwidiMidiData*> m_result;
+    std::atomic<bool> m_cancel{false};
+    std::atomic<MidiImportState> m_state{IMPORT_RUNNING};
+    std::atomic<int> m_tracksDone{0};
+    std::atomic<int> m_tracksTotal{0};
+};
+
+}
+
+#endif //GWIDI_MIDI_PARSER_GWIDI_MIDI_IMPORT_HANDLE_H
@@ -1,7 +1,11 @@
 #ifndef GWIDI_MIDI_PARSER_GWIDI_MIDI_PARSER_H
 #define GWIDI_MIDI_PARSER_GWIDI_MIDI_PARSER_H
 
+#include <memory>
+#include <cstdint>
+#include <vector>
 #include "GwidiMidiData.h"
+#include "GwidiMidiStream.h"
 
 namespace gwidi::midi {
 
@@ -9,6 +13,12 @@ namespace gwidi::midi {
 struct MidiParseOptions {
     std::string instrument;
     int chosen_track{0};
+    int chosen_channel{-1};     // only the notes of this midi channel (0-15), -1 for every channel of the track
+};
+
+struct MidiParseChannelStats {
+    std::string instrument;     // first program change on the channel
+    int num_notes{0};
 };
 
 struct MidiParseTrackStats {
@@ -17,8 +27,20 @@ struct MidiParseTrackStats {
     int num_notes;
     double tempo;
     double duration;
+    // Channels that play notes in this track, type 0 files keep every part in one track split only by channel
+    std::map<int, MidiParseChannelStats> channels;
 };
 
+// How a midi file on disk is brought in for decoding
+enum MidiReadMode {
+    READ_STREAM = 0,    // read through a file stream
+    READ_MAPPED = 1     // memory map the file and decode it in place
+};
+
+class MidiDocument;
+class MidiImportHandle;
+
+// Holds no state of its own, so the same instance can be used from several import threads at once
 class GwidiMidiParser {
 public:
     using TrackMeta = std::map<int, MidiParseTrackStats>;
@@ -27,9 +49,34 @@ public:
         return instance;
     }
 
+    // Parse a file once and keep it around, so that listing tracks and (re-)importing them doesn't parse it again
+    std::shared_ptr<MidiDocument> openDocument(const char* midiName, MidiReadMode mode = READ_STREAM);
+    // Same as above, for midi bytes already held in memory (downloads, drag and drop, etc.)
+    std::shared_ptr<MidiDocument> openDocument(const std::uint8_t* data, std::size_t size);
+
     // Used to let users choose which track to pick when midi importing (passed in MidiParseOptions)
-    TrackMeta getTrackMetaMap(const char* midiName);
-    gwidi::data::midi::GwidiMidiData* readFile(const char* midiName, const MidiParseOptions& options);
+    TrackMeta getTrackMetaMap(const char* midiName, MidiReadMode mode = READ_STREAM);
+    TrackMeta getTrackMetaMap(const std::uint8_t* data, std::size_t size);
+    // The imported song, shared read-only by playback, previews and the editor (edit() gives a copy to change)
+    gwidi::data::midi::GwidiMidiSnapshot readSnapshot(const char* midiName, const MidiParseOptions& options, MidiReadMode mode = READ_STREAM);
+    gwidi::data::midi::GwidiMidiSnapshot readSnapshot(const std::uint8_t* data, std::size_t size, const MidiParseOptions& options);
+    // Deprecated, the caller owns the returned data and has to delete it, use readSnapshot
+    gwidi::data::midi::GwidiMidiData* readFile(const char* midiName, const MidiParseOptions& options, MidiReadMode mode = READ_STREAM);
+    gwidi::data::midi::GwidiMidiData* readFile(const std::uint8_t* data, std::size_t size, const MidiParseOptions& options);
+
+    // Multi-track import, every entry picks a track and its instrument, the tracks are converted in parallel
+    gwidi::data::midi::GwidiMidiSnapshot readTracksSnapshot(const char* midiName, const std::vector<MidiParseOptions>& trackOptions, MidiReadMode mode = READ_STREAM);
+    // Deprecated, the caller owns the returned data and has to delete it, use readTracksSnapshot
+    gwidi::data::midi::GwidiMidiData* readTracks(const char* midiName, const std::vector<MidiParseOptions>& trackOptions, MidiReadMode mode = READ_STREAM);
+
+    // Same imports on a background thread, so the caller (UI thread) isn't blocked, see MidiImportHandle
+    std::shared_ptr<MidiImportHandle> readFileAsync(const std::string& midiName, const MidiParseOptions& options, MidiReadMode mode = READ_STREAM);
+    std::shared_ptr<MidiImportHandle> readFileAsync(std::vector<std::uint8_t> bytes, const MidiParseOptions& options);
+    std::shared_ptr<MidiImportHandle> readTracksAsync(const std::string& midiName, const std::vector<MidiParseOptions>& trackOptions, MidiReadMode mode = READ_STREAM);
+
+    // Playback can start on the returned stream right away, the import keeps filling it in time order on a background thread
+    // Dropping the last reference to the stream cancels the import and waits for the thread to stop
+    std::shared_ptr<gwidi::data::midi::GwidiMidiStream> readFileStreaming(const std::string& midiName, const MidiParseOptions& options, MidiReadMode mode = READ_STREAM);
 };
 
 
@@ -0,0 +1,79 @@
+#ifndef GWIDI_MIDI_PARSER_GWIDI_SMF_DECODER_H
+#define GWIDI_MIDI_PARSER_GWIDI_SMF_DECODER_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "GwidiTempoMap.h"
+
+namespace gwidi::midi {
+
+// A note-on linked to its note-off, with times already resolved through the file's tempo map
+struct SmfNote {
+    std::int64_t start_tick{0};
+    std::int64_t end_tick{-1};      // -1 when no note-off was found
+    double start_seconds{0.0};
+    double duration_seconds{0.0};
+    std::uint8_t key{0};
+    std::uint8_t channel{0};
+    std::uint8_t velocity{0};
+    std::uint8_t program{0};
+};
+
+struct SmfTrack {
+    std::vector<SmfNote> notes;
+    std::string name;               // last track name in the track
+    std::string first_instrument;   // first instrument name / program change in the track
+    std::string instrument;         // last instrument name / program change in the track
+    int num_note_ons{0};
+    std::array<int, 16> channel_note_ons{};     // num_note_ons per midi channel
+    std::array<int, 16> channel_programs{};     // first program change per midi channel, -1 for none
+    double tempo{0.0};              // last tempo in the track, in seconds per quarter note
+    std::int64_t end_tick{0};
+    double end_seconds{0.0};
+};
+
+using SmfTempoChange = gwidi::data::midi::TempoChange;
+
+struct SmfData {
+    int format{0};
+    int ticks_per_quarter{0};
+    std::vector<SmfTrack> tracks;
+    std::vector<SmfTempoChange> tempos;     // sorted by tick
+    gwidi::data::midi::TempoMap tempo_map;  // built from tempos (or the SMPTE division)
+
+    // Tempo of the file as a single value, the last tempo event (in track order) wins
+    double tempo{0.0};
+    double tempo_micro{0.0};
+};
+
+enum SmfDecodeMode {
+    DECODE_FULL = 0,    // notes paired and resolved to seconds
+    DECODE_SKIM = 1     // track names, instruments, tempos, note-on counts and end times only, SmfTrack::notes stays empty
+};
+
+// Purpose-built standard midi file decoder for the import path
+// Reads varints, running status, meta / sysex and note-on/off pairs in a single streaming pass over the bytes,
+// without building an event graph. Note times are resolved against the merged tempo map once all tracks are read.
+class SmfDecoder {
+public:
+    // Returns false for a missing header or a malformed track, out then holds the tracks read up to the error
+    static bool decode(const std::uint8_t* data, std::size_t size, SmfData& out, SmfDecodeMode mode = DECODE_FULL);
+
+#if defined(GWIDI_MIDI_WITH_MIDIFILE)
+    // Fallback through the midifile library, producing the same SmfData
+    static bool decodeWithMidifile(const std::uint8_t* data, std::size_t size, SmfData& out);
+#endif
+
+    static const char* keyLetter(int key);
+    static inline int keyOctave(int key) {
+        return key / 12 - 1;
+    }
+    static const char* programName(int program);
+};
+
+}
+
+#endif //GWIDI_MIDI_PARSER_GWIDI_SMF_DECODER_H
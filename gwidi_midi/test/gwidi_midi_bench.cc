@@ -0,0 +1,163 @@
+#include "gwidi_smf_decoder.h"
+#include "gwidi_midi_parser.h"
+#include "GwidiMidiData.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#if defined(WIN32) || defined(WIN64)
+#define ASSETS_DIR R"(E:\Tools\repos\gwidi_midi_parser\assets)"
+#elif defined(__linux__)
+#define ASSETS_DIR R"(/home/zhensley/repos/gwidi_godot/gwidi_midi_parser/assets)"
+#endif
+
+using DecodeFn = bool(*)(const std::uint8_t*, std::size_t, gwidi::midi::SmfData&);
+
+bool skimDecode(const std::uint8_t* data, std::size_t size, gwidi::midi::SmfData& out) {
+    return gwidi::midi::SmfDecoder::decode(data, size, out, gwidi::midi::DECODE_SKIM);
+}
+
+bool fullDecode(const std::uint8_t* data, std::size_t size, gwidi::midi::SmfData& out) {
+    return gwidi::midi::SmfDecoder::decode(data, size, out);
+}
+
+// Average milliseconds per decode of the given bytes
+double timeDecode(DecodeFn fn, const std::vector<std::uint8_t> &bytes, int iterations) {
+    gwidi::midi::SmfData data;
+    auto start = std::chrono::steady_clock::now();
+    for(auto i = 0; i < iterations; i++) {
+        fn(bytes.data(), bytes.size(), data);
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return elapsed / iterations;
+}
+
+// Average milliseconds per readFromMemory of an encoded .gwd
+double timeGwdDecode(const std::vector<std::uint8_t> &bytes, int iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for(auto i = 0; i < iterations; i++) {
+        delete gwidi::data::midi::GwidiMidiData::readFromMemory(bytes.data(), bytes.size());
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+inline double megabytesPerSecond(std::size_t bytes, double ms) {
+    return double(bytes) / 1e6 / (ms / 1000.0);
+}
+
+// Footprint and a start time scan of a large score, one Note per entry vs the column storage GwidiMidiData keeps
+void benchNoteStorage(std::size_t count, int iterations) {
+    std::vector<gwidi::data::midi::Note> notes;
+    gwidi::data::midi::NoteColumns columns;
+    notes.reserve(count);
+    columns.reserve(count);
+    for(std::size_t i = 0; i < count; i++) {
+        gwidi::data::midi::Note n{i * 0.125, 0.125, int(i % 3), std::string(1, char('a' + i % 7)), "harp", 0, std::to_string(i % 8 + 1)};
+        columns.push_back(n);
+        notes.emplace_back(std::move(n));
+    }
+    std::size_t vectorBytes = notes.capacity() * sizeof(gwidi::data::midi::Note);
+
+    double sum{0};
+    auto start = std::chrono::steady_clock::now();
+    for(auto it = 0; it < iterations; it++) {
+        for(auto &n : notes) {
+            sum += n.start_offset;
+        }
+    }
+    auto vectorMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+    start = std::chrono::steady_clock::now();
+    for(auto it = 0; it < iterations; it++) {
+        for(auto s : columns.startOffsets()) {
+            sum += s;
+        }
+    }
+    auto columnsMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+    spdlog::info("{} notes: vector<Note> {} bytes, columns {} bytes ({:.2f}x smaller), start scan {:.4f} ms vs {:.4f} ms ({:.2f}x) [{}]",
+                 count, vectorBytes, columns.memoryUsage(), double(vectorBytes) / columns.memoryUsage(), vectorMs, columnsMs, vectorMs / columnsMs, sum > 0);
+}
+
+int main(int argc, char** argv) {
+    spdlog::set_level(spdlog::level::info);
+    std::string assetsDir = argc > 1 ? argv[1] : ASSETS_DIR;
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 200;
+
+    double nativeTotal{0};
+    double midifileTotal{0};
+    double skimTotal{0};
+    std::size_t rawBytesTotal{0};
+    std::size_t compactBytesTotal{0};
+    double rawDecodeTotal{0};
+    double compactDecodeTotal{0};
+    for(auto &entry : std::filesystem::directory_iterator(assetsDir)) {
+        if(entry.path().extension() != ".mid") {
+            continue;
+        }
+        std::ifstream in(entry.path(), std::ios::in | std::ios::binary);
+        std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+        auto nativeMs = timeDecode(&fullDecode, bytes, iterations);
+        nativeTotal += nativeMs;
+        auto skimMs = timeDecode(&skimDecode, bytes, iterations);
+        skimTotal += skimMs;
+        spdlog::info("{}: skim: {:.4f} ms", entry.path().filename().string(), skimMs);
+
+        // Time to first playable note, blocking import vs streaming import of the longest track
+        auto path = entry.path().string();
+        auto meta = gwidi::midi::GwidiMidiParser::getInstance().getTrackMetaMap(path.c_str());
+        auto longest = std::max_element(meta.begin(), meta.end(), [](const auto &a, const auto &b) {
+            return a.second.num_notes < b.second.num_notes;
+        });
+        gwidi::midi::MidiParseOptions options{"default", longest != meta.end() ? longest->first : 0};
+        auto start = std::chrono::steady_clock::now();
+        delete gwidi::midi::GwidiMidiParser::getInstance().readFile(path.c_str(), options);
+        auto blockingMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        auto stream = gwidi::midi::GwidiMidiParser::getInstance().readFileStreaming(path, options);
+        stream->waitForWatermark(0.000001);
+        auto firstNoteMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stream->waitFinished();
+        spdlog::info("{}: readFile: {:.4f} ms, streaming first chunk: {:.4f} ms", entry.path().filename().string(), blockingMs, firstNoteMs);
+
+        // Raw vs compact .gwd of the same import, decode includes the checksum and the tick map build
+        auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(path.c_str(), options);
+        auto raw = data->encode(gwidi::data::midi::GWD_RAW);
+        auto compact = data->encode(gwidi::data::midi::GWD_COMPACT);
+        delete data;
+        auto rawDecodeMs = timeGwdDecode(raw, iterations);
+        auto compactDecodeMs = timeGwdDecode(compact, iterations);
+        rawBytesTotal += raw.size();
+        compactBytesTotal += compact.size();
+        rawDecodeTotal += rawDecodeMs;
+        compactDecodeTotal += compactDecodeMs;
+        spdlog::info("{}: .gwd raw {} bytes, compact {} bytes ({:.2f}x smaller), decode raw {:.4f} ms ({:.1f} MB/s), compact {:.4f} ms ({:.1f} MB/s)",
+                     entry.path().filename().string(), raw.size(), compact.size(), double(raw.size()) / compact.size(),
+                     rawDecodeMs, megabytesPerSecond(raw.size(), rawDecodeMs), compactDecodeMs, megabytesPerSecond(compact.size(), compactDecodeMs));
+#if defined(GWIDI_MIDI_WITH_MIDIFILE)
+        auto midifileMs = timeDecode(&gwidi::midi::SmfDecoder::decodeWithMidifile, bytes, iterations);
+        midifileTotal += midifileMs;
+        spdlog::info("{}: {} bytes, native: {:.4f} ms, midifile: {:.4f} ms, speedup: {:.2f}x", entry.path().filename().string(), bytes.size(), nativeMs, midifileMs, midifileMs / nativeMs);
+#else
+        spdlog::info("{}: {} bytes, native: {:.4f} ms", entry.path().filename().string(), bytes.size(), nativeMs);
+#endif
+    }
+
+    benchNoteStorage(100000, iterations);
+    if(compactBytesTotal > 0) {
+        spdlog::info("total .gwd raw {} bytes, compact {} bytes ({:.2f}x smaller), decode raw {:.4f} ms ({:.1f} MB/s), compact {:.4f} ms ({:.1f} MB/s, {:.2f}x the raw decode time)",
+                     rawBytesTotal, compactBytesTotal, double(rawBytesTotal) / compactBytesTotal,
+                     rawDecodeTotal, megabytesPerSecond(rawBytesTotal, rawDecodeTotal),
+                     compactDecodeTotal, megabytesPerSecond(compactBytesTotal, compactDecodeTotal), compactDecodeTotal / rawDecodeTotal);
+    }
+    spdlog::info("total skim: {:.4f} ms, {:.2f}x faster than a full native decode", skimTotal, nativeTotal / skimTotal);
+#if defined(GWIDI_MIDI_WITH_MIDIFILE)
+    spdlog::info("total native: {:.4f} ms, midifile: {:.4f} ms, speedup: {:.2f}x", nativeTotal, midifileTotal, midifileTotal / nativeTotal);
+#else
+    spdlog::info("total native: {:.4f} ms (midifile fallback not built, no comparison)", nativeTotal);
+#endif
+    return 0;
+}
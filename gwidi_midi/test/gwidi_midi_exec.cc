@@ -1,8 +1,26 @@
 #include "gwidi_midi_parser.h"
+#include "gwidi_midi_document.h"
+#include "gwidi_smf_decoder.h"
+#include "gwidi_midi_import_cache.h"
+#include "gwidi_midi_batch.h"
+#include "gwidi_midi_import_handle.h"
 #include "spdlog/spdlog.h"
 #include "GwidiOptions2.h"
 #include "GwidiGuiData.h"
 #include "GwidiDataConverter.h"
+#include "GwidiGwdFormat.h"
+#include "GwidiMappedMidiData.h"
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <memory_resource>
+#include <type_traits>
+#include <stdexcept>
 
 #if defined(WIN32) || defined(WIN64)
 #define TEST_FILE R"(E:\Tools\repos\gwidi_midi_parser\assets\test2_data.mid)"
@@ -19,8 +37,9 @@ void testWriteAndRead(gwidi::data::midi::GwidiMidiData* in) {
     spdlog::debug("printing tick map, size: {}", tickMap.size());
     for(auto &entry : tickMap) {
         spdlog::debug("time: {}, # of notes: {}", entry.first, entry.second.size());
-        for(auto &n : entry.second) {
-            spdlog::debug("\t\tnote: {}, duration: {}, instrumentOctave: {}, instrumentKey: {}", n.letter, n.duration, n.octave, n.key);
+        for(auto &ref : entry.second) {
+            auto n = readData->note(ref);
+            spdlog::debug("\t\tnote: {}, duration: {}, instrumentOctave: {}, instrumentKey: {}", n.letter.str(), n.duration, n.octave, n.key.str());
         }
     }
 
@@ -86,7 +105,7 @@ void testConversionMidiToGui() {
         FMT_ASSERT(midiTickIt->second.size() == guiTickIt->second.size(), "Tick size of notes did not match");
 
         for(auto j = 0; j < midiTickIt->second.size(); j++) {
-            auto &midiNote = midiTickIt->second.at(j);
+            auto midiNote = midiData->note(midiTickIt->second.at(j));
             auto &guiNote = guiTickIt->second.at(j);
             FMT_ASSERT(midiNote.key == guiNote.key, "Notes did not match (key)");
             FMT_ASSERT(midiNote.octave == guiNote.octave, "Notes did not match (key)");
@@ -125,7 +144,7 @@ void testConversionGuiToMidi() {
         FMT_ASSERT(midiTickIt->second.size() == guiTickIt->second.size(), "Tick size of notes did not match");
 
         for(auto j = 0; j < midiTickIt->second.size(); j++) {
-            auto &midiNote = midiTickIt->second.at(j);
+            auto midiNote = data->note(midiTickIt->second.at(j));
             auto &guiNote = guiTickIt->second.at(j);
             FMT_ASSERT(midiNote.key == guiNote.key, "Notes did not match (key)");
             FMT_ASSERT(midiNote.octave == guiNote.octave, "Notes did not match (key)");
@@ -151,7 +170,933 @@ void testTrackMetaData() {
     FMT_ASSERT(trackMetaMap.at(1).instrument == "Acoustic Grand Piano", "Instrument did not match");
     FMT_ASSERT(trackMetaMap.at(1).num_notes == 22, "num_notes did not match");
     FMT_ASSERT(trackMetaMap.at(1).tempo == 0, "tempo did not match");
-    FMT_ASSERT(trackMetaMap.at(1).duration == 15.499984499999995, "duration");
+    FMT_ASSERT(fabs(trackMetaMap.at(1).duration - 15.4999845) < 0.000001, "duration");   // Exact value depends on how the decoder accumulates seconds
+}
+
+void testDocumentReuse() {
+    auto doc = gwidi::midi::GwidiMidiParser::getInstance().openDocument(TEST_FILE);
+    auto &trackMetaMap = doc->getTrackMetaMap();
+    FMT_ASSERT(trackMetaMap.size() == std::size_t(doc->trackCount()), "track meta does not cover every track");
+    FMT_ASSERT(trackMetaMap.at(1).num_notes == 22, "num_notes did not match");
+
+    // getTrackMetaMap skims the file, it has to agree with the full decode
+    auto skimmed = gwidi::midi::GwidiMidiParser::getInstance().getTrackMetaMap(TEST_FILE);
+    FMT_ASSERT(skimmed.size() == trackMetaMap.size(), "skim track count does not match");
+    for(auto &entry : trackMetaMap) {
+        auto &skim = skimmed.at(entry.first);
+        FMT_ASSERT(skim.name == entry.second.name && skim.instrument == entry.second.instrument, "skim name/instrument does not match");
+        FMT_ASSERT(skim.num_notes == entry.second.num_notes && skim.tempo == entry.second.tempo, "skim num_notes/tempo does not match");
+        FMT_ASSERT(skim.duration == entry.second.duration, "skim duration does not match");
+    }
+
+    auto fromDoc = doc->convert(gwidi::midi::MidiParseOptions{"default", 1});
+    auto fromFile = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    FMT_ASSERT(*fromDoc == *fromFile, "document conversion does not match readFile");
+
+    // Re-import the same document with another instrument, without parsing again
+    auto harp = doc->convert(gwidi::midi::MidiParseOptions{"harp", 1});
+    FMT_ASSERT(harp->getTracks().size() == 1, "# of tracks does not match expected");
+    FMT_ASSERT(harp->getTempo() == fromDoc->getTempo(), "tempo does not match");
+
+    delete harp;
+    delete fromFile;
+    delete fromDoc;
+}
+
+void testReadFromMemory() {
+    auto fromFile = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+
+    std::ifstream in(TEST_FILE, std::ios::in | std::ios::binary);
+    std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    auto fromBytes = gwidi::midi::GwidiMidiParser::getInstance().readFile(bytes.data(), bytes.size(), gwidi::midi::MidiParseOptions{"default", 1});
+    FMT_ASSERT(*fromFile == *fromBytes, "in-memory import does not match readFile");
+
+    auto fromMapped = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1}, gwidi::midi::READ_MAPPED);
+    FMT_ASSERT(*fromFile == *fromMapped, "mapped import does not match readFile");
+
+    delete fromMapped;
+    delete fromBytes;
+    delete fromFile;
+}
+
+void testParallelTracks() {
+    auto doc = gwidi::midi::GwidiMidiParser::getInstance().openDocument(TEST_FILE);
+    auto all = doc->convertAllTracks("default", 4);
+    FMT_ASSERT(all->getTracks().size() == std::size_t(doc->trackCount()), "# of tracks does not match expected");
+
+    // Every converted track has to match the single track import of it
+    for(auto i = 0; i < doc->trackCount(); i++) {
+        auto single = doc->convert(gwidi::midi::MidiParseOptions{"default", i});
+        auto &expected = single->getTracks().front();
+        auto &actual = all->getTracks().at(i);
+        FMT_ASSERT(expected.notes.size() == actual.notes.size(), "# of notes does not match expected");
+        FMT_ASSERT(expected.track_name == actual.track_name, "track name does not match expected");
+        delete single;
+    }
+
+    auto mixed = gwidi::midi::GwidiMidiParser::getInstance().readTracks(TEST_FILE, {
+        gwidi::midi::MidiParseOptions{"harp", 1},
+        gwidi::midi::MidiParseOptions{"flute", 1}
+    });
+    FMT_ASSERT(mixed->getTracks().size() == 2, "# of tracks does not match expected");
+
+    delete mixed;
+    delete all;
+}
+
+void testImportCache() {
+    auto cacheDir = (std::filesystem::temp_directory_path() / "gwidi_import_cache_test").string();
+    std::filesystem::remove_all(cacheDir);
+
+    gwidi::midi::GwidiMidiImportCache cache(cacheDir, 1024 * 1024);
+    auto miss = cache.readSnapshot(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto hit = cache.readSnapshot(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    FMT_ASSERT(*miss == *hit, "cached import does not match");
+    FMT_ASSERT(cache.stats().misses == 1 && cache.stats().hits == 1, "unexpected hit/miss counts");
+    // Entries are renamed into place, no temp file is left behind
+    for(auto &entry : std::filesystem::directory_iterator(cacheDir)) {
+        FMT_ASSERT(entry.path().extension() == ".gwd", "import cache left a temp file");
+    }
+
+    // A different instrument is a different entry
+    auto harp = cache.readSnapshot(TEST_FILE, gwidi::midi::MidiParseOptions{"harp", 1});
+    FMT_ASSERT(cache.stats().misses == 2 && cache.stats().entries == 2, "unexpected entry count");
+
+    // Shrinking the cap evicts the least recently used entry (the "default" one)
+    cache.setMaxBytes(cache.stats().bytes - 1);
+    FMT_ASSERT(cache.stats().entries == 1 && cache.stats().evictions == 1, "LRU eviction did not happen");
+    auto harpAgain = cache.readSnapshot(TEST_FILE, gwidi::midi::MidiParseOptions{"harp", 1});
+    FMT_ASSERT(cache.stats().hits == 2, "most recent entry was evicted");
+
+    // A failed import is not stored, the next read tries again
+    auto missing = cache.readSnapshot("gwidi_import_cache_missing.mid", gwidi::midi::MidiParseOptions{"default", 1});
+    cache.readSnapshot("gwidi_import_cache_missing.mid", gwidi::midi::MidiParseOptions{"default", 1});
+    FMT_ASSERT(missing->getTracks().empty() && cache.stats().misses == 4 && cache.stats().entries == 1, "empty import was cached");
+
+    // Temp files left behind by a crashed writer are swept when the cache is opened, fresh ones are left alone
+    auto staleTemp = std::filesystem::path(cacheDir) / "0000000000000001.gwd.1.tmp";
+    auto freshTemp = std::filesystem::path(cacheDir) / "0000000000000001.gwd.2.tmp";
+    std::ofstream(staleTemp) << "partial";
+    std::ofstream(freshTemp) << "partial";
+    std::filesystem::last_write_time(staleTemp, std::filesystem::file_time_type::clock::now() - std::chrono::hours(1));
+    gwidi::midi::GwidiMidiImportCache reopened(cacheDir, 1024 * 1024);
+    FMT_ASSERT(!std::filesystem::exists(staleTemp) && std::filesystem::exists(freshTemp), "stale temp file was not swept");
+    FMT_ASSERT(reopened.stats().entries == 1, "reopened cache lost its entry");
+
+    // Any field the conversion reads is part of the key, instrument_octave included
+    std::ifstream midiIn(TEST_FILE, std::ios::in | std::ios::binary);
+    std::vector<std::uint8_t> midiBytes{std::istreambuf_iterator<char>(midiIn), std::istreambuf_iterator<char>()};
+    auto &options = gwidi::options2::GwidiOptions2::getInstance();
+    auto &mappedNote = options.getMapping().at("default").octaves.front().notes.front();
+    auto keyBefore = gwidi::midi::GwidiMidiImportCache::cacheKey(midiBytes.data(), midiBytes.size(), {"default", 1});
+    mappedNote.instrument_octave++;
+    options.rebuildLookups();
+    auto keyEdited = gwidi::midi::GwidiMidiImportCache::cacheKey(midiBytes.data(), midiBytes.size(), {"default", 1});
+    mappedNote.instrument_octave--;
+    options.rebuildLookups();
+    FMT_ASSERT(keyEdited != keyBefore, "instrument_octave edit kept the cache key");
+    FMT_ASSERT(gwidi::midi::GwidiMidiImportCache::cacheKey(midiBytes.data(), midiBytes.size(), {"default", 1}) == keyBefore, "cache key is not stable");
+
+    std::filesystem::remove_all(cacheDir);
+}
+
+void testBatchImport() {
+    auto baseDir = std::filesystem::temp_directory_path() / "gwidi_batch_test";
+    std::filesystem::remove_all(baseDir);
+    std::filesystem::create_directories(baseDir / "in" / "sub");
+    std::filesystem::copy_file(TEST_FILE, baseDir / "in" / "a.mid");
+    std::filesystem::copy_file(TEST_FILE, baseDir / "in" / "a.midi");
+    std::filesystem::copy_file(TEST_FILE, baseDir / "in" / "sub" / "b.mid");
+    std::ofstream(baseDir / "in" / "broken.mid") << "not a midi file";
+
+    gwidi::midi::MidiBatchOptions options;
+    options.input_dir = (baseDir / "in").string();
+    options.output_dir = (baseDir / "out").string();
+    options.instruments = {"default", "harp"};
+    options.track_select = gwidi::midi::SELECT_TRACK_INDEX;
+    options.chosen_track = 1;
+    options.recursive = true;
+    options.thread_count = 2;
+    std::atomic<int> done{0};
+    auto results = gwidi::midi::GwidiMidiBatchImporter::run(options, [&done](const gwidi::midi::MidiBatchFileResult&) {
+        done++;
+    });
+
+    FMT_ASSERT(results.size() == 4 && done == 4, "batch did not visit every midi file");
+    FMT_ASSERT(results[0].ok() && results[0].outputs.size() == 2, "a.mid failed to convert");
+    // Same name, other extension, its own outputs
+    FMT_ASSERT(results[1].ok() && results[1].outputs[0] == (baseDir / "out" / "a.midi.default.gwd").string(), "a.midi output collides with a.mid");
+    FMT_ASSERT(results[1].outputs[0] != results[0].outputs[0], "a.midi output collides with a.mid");
+    FMT_ASSERT(!results[2].ok(), "broken.mid should report an error");
+    FMT_ASSERT(results[3].ok() && results[3].outputs[0] == (baseDir / "out" / "sub" / "b.mid.default.gwd").string(), "sub dir layout not mirrored");
+
+    auto expected = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"harp", 1});
+    auto batched = gwidi::data::midi::GwidiMidiData::readFromFile(results[0].outputs[1]);
+    FMT_ASSERT(*expected == *batched, "batch output does not match a single import");
+
+    // Something already at the output path that can't be written over is a failure, not a stale success
+    std::filesystem::remove(results[0].outputs[0]);
+    std::filesystem::create_directory(results[0].outputs[0]);
+    FMT_ASSERT(!gwidi::midi::GwidiMidiBatchImporter::importFile(results[0].input, options).ok(), "failed write counted as a success");
+
+    delete batched;
+    delete expected;
+    std::filesystem::remove_all(baseDir);
+}
+
+void testTempoMap() {
+    // 120 bpm for two quarters, then 60 bpm
+    gwidi::data::midi::TempoMap tempoMap(480, {{0, 500000}, {960, 1000000}});
+    FMT_ASSERT(tempoMap.getSegments().size() == 2, "tempo changes did not become segments");
+    FMT_ASSERT(tempoMap.secondsAtTick(480) == 0.5 && tempoMap.secondsAtTick(960) == 1.0, "seconds before the tempo change");
+    FMT_ASSERT(tempoMap.secondsAtTick(1440) == 2.0, "seconds after the tempo change");
+    FMT_ASSERT(tempoMap.beatsAtSeconds(2.0) == 3.0, "beats after the tempo change");
+    FMT_ASSERT(tempoMap.gridIndexAtSeconds(2.0, 4) == 12, "grid index after the tempo change");
+
+    // A note a bar in lands on the second measure, the last tempo alone (60 bpm) would keep it in the first
+    gwidi::data::midi::GwidiMidiData data;
+    data.assignTempo(1.0, 1000000);
+    data.assignTempoMap(tempoMap);
+    data.addTrack("default", "tempo", {gwidi::data::midi::Note{1.0 + 2.0, 0.25, 1, "C", "default", 0, "1"}}, 4.0);
+    auto guiData = gwidi::data::GwidiDataConverter::getInstance().midiToGui(&data);
+    FMT_ASSERT(guiData->getMeasures().size() == 2, "tempo map was not used for the grid");
+    delete guiData;
+
+    // Kept through a .gwd round trip
+    auto fileData = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    FMT_ASSERT(!fileData->getTempoMap().empty(), "imported data has no tempo map");
+    fileData->writeToFile("tempo_map_test.gwd");
+    auto readData = gwidi::data::midi::GwidiMidiData::readFromFile("tempo_map_test.gwd");
+    FMT_ASSERT(readData->getTempoMap() == fileData->getTempoMap(), "tempo map did not survive the round trip");
+    std::filesystem::remove("tempo_map_test.gwd");
+
+    delete readData;
+    delete fileData;
+}
+
+void testChannelDemux() {
+    // Type 0, a piano on channel 1 and a flute on channel 2 sharing the only track
+    std::vector<std::uint8_t> track = {
+            0x00, 0xFF, 0x03, 0x04, 'S', 'o', 'l', 'o',
+            0x00, 0xC0, 0x00,
+            0x00, 0xC1, 0x49,
+            0x00, 0x90, 0x3C, 0x40,
+            0x00, 0x91, 0x3E, 0x40,
+            0x60, 0x80, 0x3C, 0x00,
+            0x00, 0x81, 0x3E, 0x00,
+            0x00, 0x91, 0x40, 0x40,
+            0x60, 0x81, 0x40, 0x00,
+            0x00, 0xFF, 0x2F, 0x00
+    };
+    std::vector<std::uint8_t> bytes = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0, 0x60, 'M', 'T', 'r', 'k', 0, 0, 0, std::uint8_t(track.size())};
+    bytes.insert(bytes.end(), track.begin(), track.end());
+
+    auto trackMetaMap = gwidi::midi::GwidiMidiParser::getInstance().getTrackMetaMap(bytes.data(), bytes.size());
+    auto &channels = trackMetaMap.at(0).channels;
+    FMT_ASSERT(channels.size() == 2, "channels did not match");
+    FMT_ASSERT(channels.at(0).num_notes == 1 && channels.at(0).instrument == "Acoustic Grand Piano", "channel 1 stats did not match");
+    FMT_ASSERT(channels.at(1).num_notes == 2 && channels.at(1).instrument == "Flute", "channel 2 stats did not match");
+
+    auto flute = gwidi::midi::GwidiMidiParser::getInstance().readFile(bytes.data(), bytes.size(), gwidi::midi::MidiParseOptions{"default", 0, 1});
+    FMT_ASSERT(flute->getTracks().front().notes.size() == 2, "chosen_channel did not filter the notes");
+    FMT_ASSERT(flute->getTracks().front().instrument_name == "Flute", "channel instrument did not match");
+
+    // Every channel from the one decode
+    auto doc = gwidi::midi::GwidiMidiParser::getInstance().openDocument(bytes.data(), bytes.size());
+    auto split = doc->convertAllChannels(0, "default");
+    FMT_ASSERT(split->getTracks().size() == 2, "channels were not split into tracks");
+    FMT_ASSERT(split->getTracks().at(0).notes.size() == 1 && split->getTracks().at(1).notes.size() == 2, "split track notes did not match");
+    // Split notes belong to their new track, not to the midi track they came from
+    FMT_ASSERT(split->getTracks().at(0).notes.tracks().front() == 0 && split->getTracks().at(1).notes.tracks().front() == 1, "split notes kept the source track");
+    // Same for a whole midi track, its notes are numbered by where it lands, not by chosen_track
+    auto whole = gwidi::midi::GwidiMidiParser::getInstance().readSnapshot(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    FMT_ASSERT(!whole->getTracks().front().notes.empty() && whole->getTracks().front().notes.tracks().front() == 0, "whole track notes kept the midi track");
+
+    // Below -1 is not "every channel", it is rejected like any other bad channel
+    auto invalid = doc->convertTracks({gwidi::midi::MidiParseOptions{"default", 0, -2}});
+    FMT_ASSERT(invalid && invalid->getTracks().empty(), "negative channel was converted");
+    delete invalid;
+
+    delete split;
+    delete flute;
+}
+
+// A one track type 0 file around the given track events
+std::vector<std::uint8_t> smfBytes(const std::vector<std::uint8_t> &track) {
+    std::vector<std::uint8_t> bytes = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0, 0x60, 'M', 'T', 'r', 'k', 0, 0, 0, std::uint8_t(track.size())};
+    bytes.insert(bytes.end(), track.begin(), track.end());
+    return bytes;
+}
+
+void testRunningStatus() {
+    // Running status carries over channel events
+    auto chord = smfBytes({
+            0x00, 0x90, 0x3C, 0x40,
+            0x00, 0x3E, 0x40,
+            0x60, 0x80, 0x3C, 0x00,
+            0x00, 0x3E, 0x00,
+            0x00, 0xFF, 0x2F, 0x00
+    });
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(chord.data(), chord.size(), gwidi::midi::MidiParseOptions{"default", 0});
+    FMT_ASSERT(data->getTracks().front().notes.size() == 2, "running status note was dropped");
+    delete data;
+
+    // A meta event cancels it, the data bytes after one are not another note-on
+    auto afterMeta = smfBytes({
+            0x00, 0x90, 0x3C, 0x40,
+            0x00, 0xFF, 0x01, 0x01, 'x',
+            0x00, 0x3E, 0x40,
+            0x60, 0x80, 0x3C, 0x00,
+            0x00, 0xFF, 0x2F, 0x00
+    });
+    FMT_ASSERT(gwidi::midi::GwidiMidiParser::getInstance().getTrackMetaMap(afterMeta.data(), afterMeta.size()).at(0).num_notes == 1, "running status survived a meta event");
+
+    // So does a sysex event
+    auto afterSysex = smfBytes({
+            0x00, 0x90, 0x3C, 0x40,
+            0x00, 0xF0, 0x02, 0x7E, 0xF7,
+            0x00, 0x3E, 0x40,
+            0x60, 0x80, 0x3C, 0x00,
+            0x00, 0xFF, 0x2F, 0x00
+    });
+    FMT_ASSERT(gwidi::midi::GwidiMidiParser::getInstance().getTrackMetaMap(afterSysex.data(), afterSysex.size()).at(0).num_notes == 1, "running status survived a sysex event");
+
+    // System real-time bytes don't belong in a file, they are not read as a channel event with two data bytes
+    auto realTime = smfBytes({
+            0x00, 0x90, 0x3C, 0x40,
+            0x00, 0xF8,
+            0x00, 0x90, 0x3E, 0x40,
+            0x60, 0x80, 0x3C, 0x00,
+            0x00, 0xFF, 0x2F, 0x00
+    });
+    FMT_ASSERT(gwidi::midi::GwidiMidiParser::getInstance().getTrackMetaMap(realTime.data(), realTime.size()).at(0).num_notes == 1, "system status was decoded as a channel event");
+}
+
+void testTruncatedTrack() {
+    gwidi::midi::SmfData decoded;
+    auto complete = smfBytes({
+            0x00, 0x90, 0x3C, 0x40,
+            0x60, 0x80, 0x3C, 0x00,
+            0x00, 0xFF, 0x2F, 0x00
+    });
+    FMT_ASSERT(gwidi::midi::SmfDecoder::decode(complete.data(), complete.size(), decoded), "complete track was rejected");
+
+    // The MTrk ends in the middle of a note-off, the decode fails so the midifile fallback gets a go
+    auto truncated = smfBytes({
+            0x00, 0x90, 0x3C, 0x40,
+            0x60, 0x80, 0x3C
+    });
+    FMT_ASSERT(!gwidi::midi::SmfDecoder::decode(truncated.data(), truncated.size(), decoded), "truncated track was accepted");
+    FMT_ASSERT(!gwidi::midi::SmfDecoder::decode(truncated.data(), truncated.size(), decoded, gwidi::midi::DECODE_SKIM), "truncated track was accepted by the skim");
+
+    // Same for a delta time cut off mid varint
+    auto truncatedDelta = smfBytes({
+            0x00, 0x90, 0x3C, 0x40,
+            0x81
+    });
+    FMT_ASSERT(!gwidi::midi::SmfDecoder::decode(truncatedDelta.data(), truncatedDelta.size(), decoded), "truncated delta time was accepted");
+}
+
+void testZeroTempo() {
+    // A 0 microsecond Set Tempo is skipped, the 120 bpm default stays in force
+    auto zeroTempo = smfBytes({
+            0x00, 0xFF, 0x51, 0x03, 0x00, 0x00, 0x00,
+            0x00, 0x90, 0x3C, 0x40,
+            0x60, 0x80, 0x3C, 0x00,
+            0x00, 0xFF, 0x2F, 0x00
+    });
+    gwidi::midi::SmfData decoded;
+    FMT_ASSERT(gwidi::midi::SmfDecoder::decode(zeroTempo.data(), zeroTempo.size(), decoded), "zero tempo file was rejected");
+    FMT_ASSERT(decoded.tempos.empty(), "zero tempo was kept");
+    FMT_ASSERT(decoded.tempo_map.getSegments().size() == 1 && decoded.tempo_map.getSegments().front().microseconds == 500000, "zero tempo reached the tempo map");
+    FMT_ASSERT(decoded.tempo_map.gridIndexAtSeconds(1.0, 4) == 8, "grid index after a zero tempo");
+
+    // Maps built straight from changes (a .gwd read back) skip it too
+    gwidi::data::midi::TempoMap tempoMap(480, {{0, 0}, {480, 1000000}});
+    FMT_ASSERT(tempoMap.getSegments().size() == 2 && tempoMap.getSegments().front().microseconds == 500000, "zero tempo change became a segment");
+    FMT_ASSERT(tempoMap.beatsAtSeconds(2.0) == 2.5, "beats after a skipped zero tempo");
+}
+
+void testAsyncImport() {
+    auto expected = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+
+    auto handle = gwidi::midi::GwidiMidiParser::getInstance().readFileAsync(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto data = handle->waitSnapshot();
+    FMT_ASSERT(data && *data == *expected, "async import does not match readFile");
+    FMT_ASSERT(handle->ready() && handle->state() == gwidi::midi::IMPORT_DONE, "async import did not finish");
+    FMT_ASSERT(handle->progress() == 1.0 && handle->tracksDone() == 1 && handle->tracksTotal() == 1, "progress did not reach the end");
+    FMT_ASSERT(!handle->waitSnapshot(), "data handed out twice");
+
+    // Stopping between tracks throws the partial import away
+    auto doc = gwidi::midi::GwidiMidiParser::getInstance().openDocument(TEST_FILE);
+    int calls = 0;
+    auto stopped = doc->convertTracks({{"default", 0}, {"default", 1}}, 1, [&calls](int, int) {
+        calls++;
+        return false;
+    });
+    FMT_ASSERT(stopped == nullptr && calls == 1, "conversion did not stop after the first track");
+
+    // Cancelling races the worker, whichever wins the state has to agree with the result
+    auto cancelled = gwidi::midi::GwidiMidiParser::getInstance().readTracksAsync(TEST_FILE, {{"default", 0}, {"default", 1}});
+    cancelled->cancel();
+    auto cancelledData = cancelled->waitSnapshot();
+    FMT_ASSERT((cancelledData == nullptr) == (cancelled->state() == gwidi::midi::IMPORT_CANCELLED), "cancelled state does not match the result");
+
+    // A throwing task ends up failed, whether it is waited on or just dropped
+    auto throwing = [](gwidi::midi::MidiImportHandle&) -> gwidi::data::midi::GwidiMidiData* {
+        throw std::runtime_error("import task failure");
+    };
+    auto failed = gwidi::midi::MidiImportHandle::start(throwing);
+    FMT_ASSERT(!failed->waitSnapshot() && failed->state() == gwidi::midi::IMPORT_FAILED, "throwing import did not fail");
+    gwidi::midi::MidiImportHandle::start(throwing).reset();
+
+    // The deprecated raw form still hands the data over once
+    auto raw = gwidi::midi::GwidiMidiParser::getInstance().readFileAsync(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto rawData = raw->wait();
+    FMT_ASSERT(rawData && *rawData == *expected && raw->wait() == nullptr, "raw wait did not hand the data over once");
+
+    delete rawData;
+    delete expected;
+}
+
+void testStreamingImport() {
+    auto expected = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+
+    auto stream = gwidi::midi::GwidiMidiParser::getInstance().readFileStreaming(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    stream->waitForWatermark(0.000001);
+    FMT_ASSERT(stream->tickMapFloorKey(0.0) != -1.0 || stream->finished(), "first chunk arrived without notes");
+    stream->waitFinished();
+
+    FMT_ASSERT(stream->duration() == expected->getTracks().front().durationInSeconds, "stream duration does not match readFile");
+    FMT_ASSERT(stream->noteCount() == expected->getTracks().front().notes.size(), "stream note count does not match readFile");
+    for(auto &entry : expected->getTickMap()) {
+        FMT_ASSERT(stream->notesAt(entry.first).size() == entry.second.size(), "stream tick map does not match readFile");
+    }
+
+    // Chunks of one note still keep every chord together
+    auto doc = gwidi::midi::GwidiMidiParser::getInstance().openDocument(TEST_FILE);
+    gwidi::data::midi::GwidiMidiStream small;
+    doc->streamTrack(gwidi::midi::MidiParseOptions{"default", 1}, small, 1);
+    FMT_ASSERT(small.finished() && small.noteCount() == stream->noteCount(), "chunked stream lost notes");
+
+    // A cancelled stream stops at the next chunk and still finishes
+    gwidi::data::midi::GwidiMidiStream cancelled;
+    cancelled.cancel();
+    doc->streamTrack(gwidi::midi::MidiParseOptions{"default", 1}, cancelled, 1);
+    FMT_ASSERT(cancelled.finished() && cancelled.noteCount() == 0, "cancelled stream kept importing");
+
+    // Dropping a stream right away cancels its import and waits for it
+    gwidi::midi::GwidiMidiParser::getInstance().readFileStreaming(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1}).reset();
+
+    delete expected;
+}
+
+void testNoteColumns() {
+    gwidi::data::midi::NoteColumns columns;
+    std::vector<gwidi::data::midi::Note> notes{
+            {0.0, 0.5, 1, "a", "harp", 0, "1"},
+            {0.5, 0.25, 2, "b", "harp", 0, "2"},
+            {0.5, 0.25, 2, "a", "harp", 3, "1"}
+    };
+    for(auto &n : notes) {
+        columns.push_back(n);
+    }
+    FMT_ASSERT(columns.size() == notes.size(), "column size does not match");
+    for(std::size_t i = 0; i < notes.size(); i++) {
+        auto n = columns.at(i);
+        auto &expected = notes.at(i);
+        FMT_ASSERT(n.start_offset == expected.start_offset && n.duration == expected.duration && n.octave == expected.octave &&
+                   n.letter == expected.letter && n.instrument == expected.instrument && n.track == expected.track && n.key == expected.key,
+                   "column note does not round trip");
+    }
+    // Repeated strings share an id
+    FMT_ASSERT(columns.keys().at(0) == columns.keys().at(2) && columns.keys().at(0) != columns.keys().at(1), "key ids were not shared");
+    FMT_ASSERT(columns.instruments().at(1).str() == "harp", "instrument symbol does not match");
+
+    gwidi::data::midi::NoteColumns copy;
+    for(auto n : columns) {
+        copy.push_back(n);
+    }
+    FMT_ASSERT(copy == columns, "iterated copy does not match");
+    copy.clear();
+    FMT_ASSERT(copy.empty() && copy != columns, "clear left notes behind");
+}
+
+void testSymbols() {
+    gwidi::data::Symbol a{"C#"};
+    gwidi::data::Symbol b{std::string("C") + "#"};
+    FMT_ASSERT(a == b && a.id() == b.id() && std::hash<gwidi::data::Symbol>{}(a) == std::hash<gwidi::data::Symbol>{}(b), "equal strings were not interned together");
+    FMT_ASSERT(a != gwidi::data::Symbol("D") && a.str() == "C#", "symbol does not match its string");
+    FMT_ASSERT(gwidi::data::Symbol().empty() && gwidi::data::Symbol("").empty(), "empty symbol is not the empty string");
+
+    // Threads interning the same strings all agree on the ids
+    std::vector<std::thread> threads;
+    std::vector<std::uint32_t> ids(8);
+    for(std::size_t i = 0; i < ids.size(); i++) {
+        threads.emplace_back([&ids, i]() {
+            for(auto j = 0; j < 1000; j++) {
+                gwidi::data::Symbol{"symbol_" + std::to_string(j)};
+            }
+            ids[i] = gwidi::data::Symbol("symbol_500").id();
+        });
+    }
+    for(auto &t : threads) {
+        t.join();
+    }
+    FMT_ASSERT(std::all_of(ids.begin(), ids.end(), [&ids](std::uint32_t id) { return id == ids.front(); }), "threads got different ids");
+}
+
+void testTickMapIndices() {
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto &notes = data->getTracks().front().notes;
+    auto &tickMap = data->getTickMap();
+    auto times = tickMap.size();
+
+    // Re-filling gives the same map, every note indexed exactly once under its own start time
+    data->fillTickMap();
+    FMT_ASSERT(tickMap.size() == times && tickMap.noteCount() == notes.size(), "re-filled tick map does not match");
+    std::vector<bool> seen(notes.size());
+    for(auto &entry : tickMap) {
+        for(auto &ref : entry.second) {
+            FMT_ASSERT(ref.track == 0 && ref.index < notes.size() && !seen[ref.index], "tick map index is out of range or repeated");
+            FMT_ASSERT(gwidi::data::toTimeline(notes.startOffsets()[ref.index]) == gwidi::data::toTimeline(entry.first), "tick map index is under the wrong time");
+            seen[ref.index] = true;
+        }
+    }
+    delete data;
+}
+
+// Old (v1) layout, host-endian size_t prefixed fields
+void writeV1File(const std::string &filename, gwidi::data::midi::GwidiMidiData &data) {
+    std::ofstream out(filename, std::ios::out | std::ios::binary);
+    auto writeString = [&out](const std::string &str) {
+        size_t size = str.size();
+        out.write(reinterpret_cast<const char *>(&size), sizeof(size_t));
+        out.write(str.data(), size);
+    };
+    size_t track_count = data.getTracks().size();
+    double tempo = data.getTempo();
+    double tempoMicro = data.getTempoMicro();
+    out.write(reinterpret_cast<const char *>(&track_count), sizeof(size_t));
+    out.write(reinterpret_cast<const char *>(&tempo), sizeof(double));
+    out.write(reinterpret_cast<const char *>(&tempoMicro), sizeof(double));
+    for(auto &t : data.getTracks()) {
+        out.write(reinterpret_cast<const char *>(&t.durationInSeconds), sizeof(double));
+        writeString(t.instrument_name);
+        writeString(t.track_name);
+        size_t note_count = t.notes.size();
+        out.write(reinterpret_cast<const char *>(&note_count), sizeof(size_t));
+        for(auto n : t.notes) {
+            out.write(reinterpret_cast<const char *>(&n.start_offset), sizeof(double));
+            out.write(reinterpret_cast<const char *>(&n.duration), sizeof(double));
+            out.write(reinterpret_cast<const char *>(&n.octave), sizeof(int));
+            writeString(n.letter.str());
+            writeString(n.instrument.str());
+            out.write(reinterpret_cast<const char *>(&n.track), sizeof(int));
+            writeString(n.key.str());
+        }
+    }
+}
+
+void testGwdFormat() {
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    data->writeToFile("format_v2.gwd");
+    std::ifstream in("format_v2.gwd", std::ios::in | std::ios::binary);
+    std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    in.close();
+    FMT_ASSERT(gwidi::data::midi::gwd::isGwd(bytes.data(), bytes.size()), "v2 file has no magic");
+    auto fromMemory = gwidi::data::midi::GwidiMidiData::readFromMemory(bytes.data(), bytes.size());
+    FMT_ASSERT(fromMemory && *fromMemory == *data, "v2 data from memory does not match");
+
+    // v1 files still load, they just don't carry a tempo map
+    writeV1File("format_v1.gwd", *data);
+    auto v1 = gwidi::data::midi::GwidiMidiData::readFromFile("format_v1.gwd");
+    FMT_ASSERT(v1 && v1->getTracks().size() == data->getTracks().size() && v1->getTempoMap().empty(), "v1 file did not load");
+    FMT_ASSERT(v1->getTracks().front().notes == data->getTracks().front().notes, "v1 notes do not match");
+
+    // A flipped bit anywhere past the header fails the checksum
+    bytes.back() ^= 0x01;
+    std::ofstream corrupt("format_corrupt.gwd", std::ios::out | std::ios::binary);
+    corrupt.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+    corrupt.close();
+    FMT_ASSERT(gwidi::data::midi::GwidiMidiData::readFromFile("format_corrupt.gwd") == nullptr, "corrupt file was loaded");
+    FMT_ASSERT(gwidi::data::midi::GwidiMidiData::readFromFile("format_missing.gwd") == nullptr, "missing file was loaded");
+    // So does one in the header fields, here the tempo
+    bytes.back() ^= 0x01;
+    bytes[48] ^= 0x01;
+    FMT_ASSERT(gwidi::data::midi::GwidiMidiData::readFromMemory(bytes.data(), bytes.size()) == nullptr, "corrupt header was loaded");
+    FMT_ASSERT(!gwidi::data::midi::GwidiMappedMidiData().open("format_corrupt.gwd", true), "corrupt file was mapped");
+
+    delete v1;
+    delete fromMemory;
+    delete data;
+}
+
+void testMappedLoad() {
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    data->writeToFile("mapped.gwd");
+
+    gwidi::data::midi::GwidiMappedMidiData mapped;
+    FMT_ASSERT(mapped.open("mapped.gwd", true), "mapped file did not open");
+    auto &track = data->getTracks().front();
+    auto mappedTrack = mapped.track(0);
+    FMT_ASSERT(mapped.trackCount() == 1 && mappedTrack.noteCount() == track.notes.size() && mappedTrack.sortedByStart(), "mapped track does not match");
+    FMT_ASSERT(mappedTrack.trackName() == track.track_name && mappedTrack.durationInSeconds() == track.durationInSeconds, "mapped track header does not match");
+    FMT_ASSERT(mapped.getTempo() == data->getTempo() && mapped.tempoMap() == data->getTempoMap(), "mapped tempo does not match");
+    for(std::size_t i = 0; i < track.notes.size(); i++) {
+        auto n = mappedTrack.note(i);
+        FMT_ASSERT(n.start_offset == track.notes.startOffsets()[i] && n.key == track.notes.keys()[i] && n.octave == track.notes.octaves()[i], "mapped note does not match");
+        FMT_ASSERT(mapped.string(mappedTrack.letterIds()[i]) == track.notes.letters()[i].str(), "mapped letter does not match");
+    }
+
+    // Floor lookups agree with the loaded tick map, on and between the note times
+    auto &tickMap = data->getTickMap();
+    for(std::size_t i = 0; i < tickMap.size(); i++) {
+        for(auto time : {tickMap.keyAt(i), tickMap.keyAt(i) + 0.001}) {
+            auto expected = tickMap.notesAtIndex(tickMap.floorIndex(time));
+            auto range = mapped.floorNotes(time);
+            FMT_ASSERT(range.time == tickMap.keyAt(tickMap.floorIndex(time)) && range.size() == expected.size(), "mapped floor lookup does not match");
+            for(std::size_t j = 0; j < range.size(); j++) {
+                FMT_ASSERT(range.at(j) == expected[j], "mapped floor notes do not match");
+            }
+        }
+    }
+
+    // Several tracks are merged like the tick map does, ties by track then index
+    auto song = data->edit();
+    auto shifted = std::vector<gwidi::data::midi::Note>(track.notes.begin(), track.notes.end());
+    for(std::size_t i = 0; i < shifted.size(); i += 2) {
+        shifted[i].start_offset += 0.001;
+    }
+    song->addTrack("default", "second", shifted, track.durationInSeconds);
+    song->writeToFile("mapped_tracks.gwd");
+    gwidi::data::midi::GwidiMappedMidiData mappedTracks;
+    FMT_ASSERT(mappedTracks.open("mapped_tracks.gwd", true) && mappedTracks.trackCount() == 2, "mapped tracks did not open");
+    auto &songMap = song->getTickMap();
+    for(std::size_t i = 0; i < songMap.size(); i++) {
+        for(auto time : {songMap.keyAt(i), songMap.keyAt(i) + 0.0005}) {
+            auto floor = songMap.floorIndex(time);
+            auto expected = songMap.notesAtIndex(floor);
+            auto range = mappedTracks.floorNotes(time);
+            FMT_ASSERT(range.time == songMap.keyAt(floor) && range.size() == expected.size(), "mapped tracks floor lookup does not match");
+            for(std::size_t j = 0; j < range.size(); j++) {
+                FMT_ASSERT(range.at(j) == expected[j] && mappedTracks.note(range.at(j)).key == song->note(expected[j]).key, "mapped tracks floor notes do not match");
+            }
+        }
+    }
+    delete song;
+
+    auto loaded = mapped.toMidiData();
+    FMT_ASSERT(loaded && *loaded == *data, "mapped copy does not match");
+    FMT_ASSERT(!gwidi::data::midi::GwidiMappedMidiData().open("format_missing.gwd"), "missing file was mapped");
+
+    delete loaded;
+    delete data;
+}
+
+void testGwdCompact() {
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto raw = data->encode();
+    auto compact = data->encode(gwidi::data::midi::GWD_COMPACT);
+    spdlog::debug("compact .gwd: {} bytes, raw: {} bytes", compact.size(), raw.size());
+    FMT_ASSERT(compact.size() < raw.size(), "compact file is not smaller");
+
+    data->writeToFile("compact.gwd", gwidi::data::midi::GWD_COMPACT);
+    auto read = gwidi::data::midi::GwidiMidiData::readFromFile("compact.gwd");
+    FMT_ASSERT(read && read->getTracks().size() == data->getTracks().size(), "compact file did not load");
+    FMT_ASSERT(read->getTempo() == data->getTempo() && read->getTempoMap() == data->getTempoMap(), "compact tempo does not match");
+    auto &track = data->getTracks().front();
+    auto &readTrack = read->getTracks().front();
+    FMT_ASSERT(readTrack.track_name == track.track_name && readTrack.durationInSeconds == track.durationInSeconds, "compact track header does not match");
+    FMT_ASSERT(readTrack.notes.keys() == track.notes.keys() && readTrack.notes.letters() == track.notes.letters() &&
+               readTrack.notes.instruments() == track.notes.instruments() && readTrack.notes.octaves() == track.notes.octaves() &&
+               readTrack.notes.tracks() == track.notes.tracks(), "compact note fields do not match");
+    // Times come back to within half a quantum
+    for(std::size_t i = 0; i < track.notes.size(); i++) {
+        FMT_ASSERT(std::abs(readTrack.notes.startOffsets()[i] - track.notes.startOffsets()[i]) <= 0.5e-6 + 1e-12, "compact start does not match");
+        FMT_ASSERT(std::abs(readTrack.notes.durations()[i] - track.notes.durations()[i]) <= 0.5e-6 + 1e-12, "compact duration does not match");
+    }
+    FMT_ASSERT(read->getTickMap().size() == data->getTickMap().size(), "compact tick map does not match");
+    // Already quantized data encodes to the same bytes again
+    FMT_ASSERT(read->encode(gwidi::data::midi::GWD_COMPACT) == compact, "compact encoding is not stable");
+
+    FMT_ASSERT(gwidi::data::midi::GwidiMidiData::readFromMemory(compact.data(), compact.size() - 1) == nullptr, "truncated compact data was loaded");
+    // Counts the body can't hold are rejected before anything is allocated for them
+    gwidi::data::midi::gwd::Header header;
+    for(auto offset : {32, 40}) {
+        auto corrupt = compact;
+        gwidi::data::midi::gwd::storeLE<std::uint32_t>(corrupt.data() + offset, 0x7FFFFFFF);
+        FMT_ASSERT(!gwidi::data::midi::gwd::readHeader(corrupt.data(), corrupt.size(), header), "oversized compact count was accepted");
+        FMT_ASSERT(gwidi::data::midi::GwidiMidiData::readFromMemory(corrupt.data(), corrupt.size()) == nullptr, "oversized compact count was loaded");
+    }
+    FMT_ASSERT(!gwidi::data::midi::GwidiMappedMidiData().open("compact.gwd"), "compact file was mapped");
+
+    delete read;
+    delete data;
+}
+
+void testArena() {
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto arena = data->getArena();
+    auto &notes = data->getTracks().front().notes;
+    FMT_ASSERT(arena && notes.startOffsets().get_allocator().resource() == arena && notes.keys().get_allocator().resource() == arena, "columns are not in the arena");
+    FMT_ASSERT(data->getTickMap().resource() == arena, "tick map is not in the arena");
+
+    // Copies leave the arena, they still hold up after the song is dropped
+    auto copy = notes;
+    FMT_ASSERT(copy.startOffsets().get_allocator().resource() == std::pmr::get_default_resource(), "copy is still in the arena");
+    auto first = copy.front();
+    delete data;
+    FMT_ASSERT(copy.size() > 0 && copy.front().start_offset == first.start_offset && copy.front().key == first.key, "copy did not outlive the arena");
+
+    // Loaded files are carved out of their own arena too
+    auto fromFile = gwidi::data::midi::GwidiMidiData::readFromFile("compact.gwd");
+    FMT_ASSERT(fromFile && fromFile->getTracks().front().notes.durations().get_allocator().resource() == fromFile->getArena(), "loaded columns are not in the arena");
+    delete fromFile;
+
+    // Tracks moved in from another resource are copied into the new song's arena, so they outlive that resource
+    auto source = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto expected = source->getTracks().front().notes;
+    auto foreign = std::make_unique<std::pmr::monotonic_buffer_resource>();
+    std::vector<gwidi::data::midi::Track> tracks;
+    tracks.emplace_back(gwidi::data::midi::Track{gwidi::data::midi::NoteColumns(foreign.get())});
+    for (auto n: expected) {
+        tracks.back().notes.push_back(n);
+    }
+    gwidi::data::midi::GwidiMidiData moved(std::move(tracks));
+    foreign.reset();
+    delete source;
+    auto &movedNotes = moved.getTracks().front().notes;
+    FMT_ASSERT(movedNotes.keys().get_allocator().resource() == moved.getArena(), "moved columns are not in the arena");
+    FMT_ASSERT(movedNotes == expected && moved.getTickMap().noteCount() == expected.size(), "moved columns did not outlive their song");
+}
+
+void testFingerprint() {
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto fingerprint = data->fingerprint();
+    FMT_ASSERT(fingerprint != 0 && data->fingerprint() == fingerprint, "fingerprint is not stable");
+
+    // Equal data loaded another way fingerprints the same, and dedupes through std::hash
+    data->writeToFile("fingerprint.gwd");
+    auto read = gwidi::data::midi::GwidiMidiData::readFromFile("fingerprint.gwd");
+    FMT_ASSERT(read && read->fingerprint() == fingerprint && *read == *data, "reloaded fingerprint does not match");
+    FMT_ASSERT(std::hash<gwidi::data::midi::GwidiMidiData>{}(*read) == std::hash<gwidi::data::midi::GwidiMidiData>{}(*data), "hash does not match");
+
+    // Tracks only change through the mutators, so a held reference can't leave the fingerprint stale
+    static_assert(std::is_same_v<decltype(read->getTracks()), const std::vector<gwidi::data::midi::Track> &>, "tracks can be changed past the mutators");
+    auto &held = read->getTracks().front().notes;
+    read->removeNote(0, held.size() - 1);
+    FMT_ASSERT(read->fingerprint() != fingerprint && held.size() + 1 == data->getTracks().front().notes.size(), "removed note did not change the fingerprint");
+    auto removed = data->getTracks().front().notes.back();
+    read->addNote(0, removed);
+    FMT_ASSERT(read->fingerprint() == fingerprint && *read == *data, "restored note did not restore the fingerprint");
+
+    // Any change is picked up
+    auto note = read->getTracks().front().notes.back();
+    note.start_offset += 1.0;
+    read->addNote(0, note);
+    FMT_ASSERT(read->fingerprint() != fingerprint && !(*read == *data), "added note did not change the fingerprint");
+    read->assignNotes(0, std::vector<gwidi::data::midi::Note>{});
+    auto empty = read->fingerprint();
+    read->assignTempo(read->getTempo() + 1.0, read->getTempoMicro());
+    FMT_ASSERT(read->fingerprint() != empty, "tempo did not change the fingerprint");
+
+    auto other = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 0});
+    FMT_ASSERT(other->fingerprint() != fingerprint, "different tracks share a fingerprint");
+
+    delete other;
+    delete read;
+    delete data;
+}
+
+// The tick map after the edits is the one a full rebuild would give
+bool tickMapUpToDate(gwidi::data::midi::GwidiMidiData *data) {
+    auto rebuilt = data->edit();
+    rebuilt->fillTickMap();
+    auto upToDate = rebuilt->getTickMap() == data->getTickMap();
+    delete rebuilt;
+    return upToDate;
+}
+
+void testTickMapEdits() {
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto last = data->getTracks().front().notes.back();
+    auto first = data->getTracks().front().notes.front();
+
+    // After the last note, before the first one, on an existing time and between two
+    auto appended = last;
+    appended.start_offset += 1.0;
+    data->addNote(0, appended);
+    FMT_ASSERT(tickMapUpToDate(data), "tick map missed an appended note");
+    auto earliest = first;
+    earliest.start_offset -= 0.25;
+    data->addNote(0, earliest);
+    FMT_ASSERT(tickMapUpToDate(data), "tick map missed an early note");
+    data->addNote(0, first);
+    FMT_ASSERT(tickMapUpToDate(data), "tick map missed a note on an existing time");
+    auto between = first;
+    between.start_offset += 0.001;
+    data->addNote(0, between);
+    FMT_ASSERT(tickMapUpToDate(data), "tick map missed a note between times");
+
+    data->removeNote(0, 0);
+    FMT_ASSERT(tickMapUpToDate(data), "tick map kept a removed first note");
+    data->removeNote(0, data->getTracks().front().notes.size() / 2);
+    FMT_ASSERT(tickMapUpToDate(data), "tick map kept a removed note");
+    data->removeNote(0, data->getTracks().front().notes.size() - 1);
+    FMT_ASSERT(tickMapUpToDate(data), "tick map kept a removed last note");
+
+    // A batch leaves the map alone until it's committed
+    auto before = data->getTickMap().noteCount();
+    data->beginEdit();
+    for(auto i = 0; i < 50; i++) {
+        auto n = first;
+        n.start_offset = (i % 7) * 0.5;
+        data->addNote(0, n);
+    }
+    data->removeNote(0, 3);
+    FMT_ASSERT(data->getTickMap().noteCount() == before, "tick map changed during a batch");
+    data->commitEdit();
+    FMT_ASSERT(data->getTickMap().noteCount() == before + 49 && tickMapUpToDate(data), "batched tick map is not up to date");
+    // The notes after it share times with each other, each one shifts down exactly once
+    data->removeNote(0, data->getTracks().front().notes.size() - 30);
+    FMT_ASSERT(tickMapUpToDate(data), "tick map refs did not shift with a removed chord note");
+
+    data->assignNotes(0, {first, last});
+    FMT_ASSERT(data->getTickMap().noteCount() == 2 && tickMapUpToDate(data), "tick map missed assigned notes");
+
+    delete data;
+}
+
+// An editing session keeps reusing the arena, however many edits it commits
+void testArenaEdits() {
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto notes = data->getTracks().front().notes;
+    std::vector<gwidi::data::midi::Note> original(notes.begin(), notes.end());
+
+    auto edit = [&data, &original](int i) {
+        data->beginEdit();
+        auto n = original.at(i % original.size());
+        n.start_offset += 0.5;
+        data->addNote(0, n);
+        data->removeNote(0, 0);
+        data->commitEdit();
+        if(i % 10 == 0) {
+            data->assignNotes(0, original);
+        }
+    };
+    for(auto i = 0; i < 20; i++) {
+        edit(i);
+    }
+    auto footprint = data->arenaFootprint();
+    for(auto i = 20; i < 2000; i++) {
+        edit(i);
+    }
+    FMT_ASSERT(footprint > 0 && data->arenaFootprint() == footprint, fmt::format("arena grew with edits: {} -> {} bytes", footprint, data->arenaFootprint()).c_str());
+    FMT_ASSERT(tickMapUpToDate(data), "tick map is not up to date after the edits");
+
+    delete data;
+}
+
+void testMultiTrackTickMap() {
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto first = data->getTracks().front().notes;
+    auto firstCount = first.size();
+    auto duration = data->getTracks().front().durationInSeconds;
+
+    // A second voice half a beat behind, with its notes out of order, and one note in unison with the first track
+    std::vector<gwidi::data::midi::Note> harmony;
+    for(auto i = firstCount; i > 0; i--) {
+        auto n = first.at(i - 1);
+        n.start_offset += 0.25;
+        harmony.emplace_back(n);
+    }
+    harmony.emplace_back(first.at(0));
+    data->addTrack("harmony", "harmony", harmony, duration + 0.25);
+    data->addTrack("empty", "empty", {}, 0.0);
+
+    // Every note of every track once, each time's notes by track then index
+    auto &tickMap = data->getTickMap();
+    FMT_ASSERT(tickMap.noteCount() == firstCount + harmony.size(), "merged tick map lost notes");
+    std::vector<std::vector<bool>> seen{std::vector<bool>(firstCount), std::vector<bool>(harmony.size())};
+    double lastTime = -1.0;
+    for(auto &entry : tickMap) {
+        FMT_ASSERT(entry.first > lastTime, "merged tick map times are out of order");
+        lastTime = entry.first;
+        for(std::size_t j = 0; j < entry.second.size(); j++) {
+            auto &ref = entry.second[j];
+            FMT_ASSERT(ref.track < 2 && !seen[ref.track][ref.index], "merged tick map repeats a note");
+            FMT_ASSERT(gwidi::data::toTimeline(data->note(ref).start_offset) == gwidi::data::toTimeline(entry.first), "merged note is under the wrong time");
+            FMT_ASSERT(j == 0 || entry.second[j - 1] < ref, "merged notes of one time are out of order");
+            seen[ref.track][ref.index] = true;
+        }
+    }
+    auto unison = tickMap.notesAt(first.startOffsets()[0]);
+    FMT_ASSERT(std::count_if(unison.begin(), unison.end(), [](const gwidi::data::midi::NoteRef &ref) { return ref.track == 1; }) == 1, "unison note is missing");
+
+    // Edits to any track keep the merged map in step
+    auto extra = first.at(0);
+    data->addNote(1, extra);
+    FMT_ASSERT(tickMapUpToDate(data), "merged tick map missed a second track note");
+    data->addNote(0, extra);
+    FMT_ASSERT(tickMapUpToDate(data), "merged tick map misplaced a first track note");
+    data->removeNote(1, 0);
+    FMT_ASSERT(tickMapUpToDate(data), "merged tick map kept a removed second track note");
+    data->assignNotes(1, {extra});
+    FMT_ASSERT(tickMapUpToDate(data) && tickMap.noteCount() == firstCount + 2, "merged tick map missed assigned notes");
+
+    delete data;
+}
+
+void testTimelineGrouping() {
+    // A chord whose starts came out of float math a little apart, one in another track
+    auto data = new gwidi::data::midi::GwidiMidiData();
+    auto beat = 0.1 + 0.2;
+    data->addTrack("default", "melody", {
+            gwidi::data::midi::Note{0.3, 0.5, 0, "C", "", 0, "1"},
+            gwidi::data::midi::Note{beat, 0.5, 0, "E", "", 0, "3"},
+            gwidi::data::midi::Note{1.0 / 3.0, 0.5, 0, "F", "", 0, "4"}
+    }, 1.0);
+    data->addTrack("default", "harmony", {
+            gwidi::data::midi::Note{3 * 0.1, 0.5, 0, "G", "", 1, "5"}
+    }, 1.0);
+    FMT_ASSERT(beat != 0.3, "starts are not apart by float error");
+
+    // One time for the chord, looked up on either start
+    auto &tickMap = data->getTickMap();
+    FMT_ASSERT(tickMap.size() == 2 && tickMap.notesAtIndex(0).size() == 3, "chord was split by float error");
+    FMT_ASSERT(tickMap.timeAt(0) == 300000 && tickMap.keyAt(0) == 0.3, "chord time is not on the microsecond base");
+    FMT_ASSERT(tickMap.notesAt(beat).size() == 3 && tickMap.notesAt(0.3).size() == 3, "chord lookup missed a start");
+
+    // Added and removed notes find the same time
+    auto late = gwidi::data::midi::Note{0.1 + 0.2, 0.5, 0, "A", "", 1, "6"};
+    data->addNote(1, late);
+    FMT_ASSERT(tickMap.size() == 2 && tickMap.notesAtIndex(0).size() == 4 && tickMapUpToDate(data), "added note was not grouped");
+    data->removeNote(0, 0);
+    FMT_ASSERT(tickMap.notesAtIndex(0).size() == 3 && tickMapUpToDate(data), "removed note was not found");
+
+    delete data;
+}
+
+// The snapshot entry points load the same songs the owning ones do
+void testSnapshotReaders() {
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readSnapshot(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    auto raw = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions{"default", 1});
+    FMT_ASSERT(data && *data == *raw, "parser snapshot does not match readFile");
+    auto tracks = gwidi::midi::GwidiMidiParser::getInstance().readTracksSnapshot(TEST_FILE, {gwidi::midi::MidiParseOptions{"default", 1}});
+    FMT_ASSERT(tracks && *tracks == *raw, "readTracksSnapshot does not match readFile");
+
+    data->writeToFile("snapshot.gwd");
+    auto read = gwidi::data::midi::GwidiMidiData::readSnapshot("snapshot.gwd");
+    FMT_ASSERT(read && *read == *data, "file snapshot does not match");
+    FMT_ASSERT(!gwidi::data::midi::GwidiMidiData::readSnapshot("snapshot_missing.gwd"), "missing file gave a snapshot");
+
+    auto gui = gwidi::data::GwidiDataConverter::getInstance().midiToGui(data);
+    auto fromGui = gwidi::data::GwidiDataConverter::getInstance().guiToMidiSnapshot(gui);
+    FMT_ASSERT(fromGui && fromGui->getTickMap().size() == data->getTickMap().size(), "gui snapshot does not match");
+
+    delete gui;
+    delete raw;
 }
 
 int main() {
@@ -171,6 +1116,31 @@ int main() {
     testConversionMidiToGui();
     testConversionGuiToMidi();
     testTrackMetaData();
+    testDocumentReuse();
+    testReadFromMemory();
+    testParallelTracks();
+    testImportCache();
+    testBatchImport();
+    testTempoMap();
+    testChannelDemux();
+    testRunningStatus();
+    testTruncatedTrack();
+    testZeroTempo();
+    testAsyncImport();
+    testStreamingImport();
+    testNoteColumns();
+    testSymbols();
+    testTickMapIndices();
+    testGwdFormat();
+    testMappedLoad();
+    testGwdCompact();
+    testArena();
+    testFingerprint();
+    testTickMapEdits();
+    testArenaEdits();
+    testMultiTrackTickMap();
+    testTimelineGrouping();
+    testSnapshotReaders();
 
     delete data;
     return 0;
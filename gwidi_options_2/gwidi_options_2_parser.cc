@@ -1,6 +1,11 @@
 #include "GwidiOptions2.h"
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
 #include <sstream>
 #include <spdlog/spdlog.h>
 #include <linux/input-event-codes.h>
@@ -80,6 +85,8 @@ void GwidiOptions2::parseConfigs() {
         m_tempo = playbackJson["tempo"].get<double>();
         playbackConfigFile.close();
     }
+
+    rebuildLookups();
 }
 
 GwidiOptions2::operator std::string() const {
@@ -105,14 +112,111 @@ GwidiOptions2::operator std::string() const {
     return ss.str();
 }
 
-Note GwidiOptions2::optionsNoteFromMidiNote(const std::string &instrument, int in_midiOctave, const std::string &letter) {
-    for(auto &octave : instruments[instrument].octaves) {
+namespace {
+const char* s_midiLetters[12] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+}
+
+int MidiNoteLookup::midiNoteFromLetter(int midiOctave, const std::string &letter) {
+    auto letterIt = std::find(std::begin(s_midiLetters), std::end(s_midiLetters), letter);
+    if(letterIt == std::end(s_midiLetters)) {
+        return -1;
+    }
+    int midiNote = (midiOctave + 1) * 12 + int(letterIt - std::begin(s_midiLetters));
+    return midiNote >= 0 && midiNote < 128 ? midiNote : -1;
+}
+
+MidiNoteLookup::MidiNoteLookup(const Instrument &instrument) {
+    m_index.fill(-1);
+    for(auto &octave : instrument.octaves) {
         for(auto &note : octave.notes) {
-            if(note.midi_octave == in_midiOctave && std::find(note.letters.begin(), note.letters.end(), letter) != note.letters.end()) {
-                return note;
+            m_notes.emplace_back(note);
+            for(auto &letter : note.letters) {
+                auto midiNote = midiNoteFromLetter(note.midi_octave, letter);
+                // First mapping wins, same as scanning the octaves in order
+                if(midiNote != -1 && m_index[midiNote] == -1) {
+                    m_index[midiNote] = int(m_notes.size()) - 1;
+                }
+            }
+        }
+    }
+}
+
+void GwidiOptions2::rebuildLookups() {
+    // Build off to the side, lookups handed out earlier stay valid for whoever still holds them
+    std::map<std::string, std::shared_ptr<const MidiNoteLookup>> lookups;
+    for(auto &entry : instruments) {
+        lookups[entry.first] = std::make_shared<MidiNoteLookup>(entry.second);
+    }
+    // Every field the conversion reads, written out one by one with fixed widths
+    auto fingerprint = s_fnvOffset;
+    auto hashString = [&fingerprint](const std::string &str) {
+        fingerprint = fnv1a(fingerprint, std::uint64_t(str.size()));
+        fingerprint = fnv1a(fingerprint, str.data(), str.size());
+    };
+    auto hashInt = [&fingerprint](std::int64_t v) {
+        fingerprint = fnv1a(fingerprint, v);
+    };
+    hashInt(std::int64_t(instruments.size()));
+    for(auto &entry : instruments) {
+        hashString(entry.first);
+        hashInt(entry.second.supports_held_notes ? 1 : 0);
+        hashInt(entry.second.starting_octave);
+        hashInt(std::int64_t(entry.second.octaves.size()));
+        for(auto &octave : entry.second.octaves) {
+            hashInt(octave.num);
+            hashInt(std::int64_t(octave.notes.size()));
+            for(auto &note : octave.notes) {
+                hashInt(note.midi_octave);
+                hashInt(note.instrument_octave);
+                hashString(note.key);
+                hashInt(std::int64_t(note.letters.size()));
+                for(auto &letter : note.letters) {
+                    hashString(letter);
+                }
             }
         }
     }
+
+    // The files on disk count too, by content, scanned here once rather than on every configFingerprint() call
+    std::stringstream ss;
+    ss << CONFIG_DIR << "/instruments";
+    std::error_code ec;
+    std::vector<std::filesystem::path> files;
+    for(auto &entry : std::filesystem::directory_iterator(ss.str(), ec)) {
+        if(entry.path().extension() == ".json") {
+            files.emplace_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());  // directory order isn't stable
+    for(auto &file : files) {
+        std::ifstream in(file, std::ios::in | std::ios::binary);
+        std::string contents{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        hashString(file.filename().string());
+        hashString(contents);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_lookupsMutex);
+    m_lookups.swap(lookups);
+    m_configFingerprint = fingerprint;
+}
+
+std::uint64_t GwidiOptions2::configFingerprint() const {
+    std::shared_lock<std::shared_mutex> lock(m_lookupsMutex);
+    return m_configFingerprint;
+}
+
+std::shared_ptr<const MidiNoteLookup> GwidiOptions2::noteLookup(const std::string &instrument) const {
+    std::shared_lock<std::shared_mutex> lock(m_lookupsMutex);
+    auto it = m_lookups.find(instrument);
+    return it != m_lookups.end() ? it->second : nullptr;
+}
+
+Note GwidiOptions2::optionsNoteFromMidiNote(const std::string &instrument, int in_midiOctave, const std::string &letter) {
+    auto lookup = noteLookup(instrument);
+    auto note = lookup ? lookup->find(MidiNoteLookup::midiNoteFromLetter(in_midiOctave, letter)) : nullptr;
+    if(note) {
+        return *note;
+    }
     return Note {
             {},
             -1,
@@ -127,8 +231,9 @@ double GwidiOptions2::tempo() {
 
 void GwidiOptions2::addNewConfig(const std::string &configInstrumentName, const Instrument &instrument) {
     instruments[configInstrumentName] = instrument;
-
+    // Stored first, the fingerprint rebuildLookups() takes covers the rewritten files
     storeConfigs();
+    rebuildLookups();
 }
 
 void GwidiOptions2::storeConfigs() {
@@ -186,6 +291,7 @@ void GwidiOptions2::removeConfig(const std::string &configInstrumentName) {
         instruments.erase(instrEntry, instruments.end());
     }
     storeConfigs();
+    rebuildLookups();
 }
 
 
@@ -3,6 +3,11 @@
 
 // TODO: Build data definition to hold the instrument settings
 #include <map>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
 #include <vector>
 #include <string>
 #include <functional>
@@ -11,6 +16,24 @@
 namespace gwidi {
 namespace options2 {
 
+// FNV-1a, the same bytes hash the same in every build, so it is safe for keys that end up on disk
+constexpr std::uint64_t s_fnvOffset = 0xcbf29ce484222325ULL;
+constexpr std::uint64_t s_fnvPrime = 0x100000001b3ULL;
+
+inline std::uint64_t fnv1a(std::uint64_t h, const void* data, std::size_t size) {
+    auto bytes = static_cast<const std::uint8_t*>(data);
+    for(std::size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= s_fnvPrime;
+    }
+    return h;
+}
+
+template<typename T>
+inline std::uint64_t fnv1a(std::uint64_t h, const T &value) {
+    return fnv1a(h, &value, sizeof(T));
+}
+
 struct Note {
     std::vector<std::string> letters;
     int midi_octave{0};
@@ -29,6 +52,26 @@ struct Instrument {
     std::vector<Octave> octaves;
 };
 
+// An instrument compiled down to a table indexed by midi note number (0-127)
+// Each entry points at the mapped note (key + instrument octave), so a lookup is a single index
+class MidiNoteLookup {
+public:
+    explicit MidiNoteLookup(const Instrument &instrument);
+
+    inline const Note* find(int midiNote) const {
+        if(midiNote < 0 || midiNote >= int(m_index.size()) || m_index[midiNote] < 0) {
+            return nullptr;
+        }
+        return &m_notes[m_index[midiNote]];
+    }
+
+    static int midiNoteFromLetter(int midiOctave, const std::string &letter);
+
+private:
+    std::vector<Note> m_notes;
+    std::array<int, 128> m_index{};
+};
+
 class GwidiOptions2 {
 public:
     using Mapping = std::map<std::string, Instrument>;
@@ -36,10 +79,20 @@ public:
     static GwidiOptions2 &getInstance();
 
     explicit operator std::string() const;
+    // Edits through the mapping are not synchronized, finish them (and rebuildLookups()) before importing on other threads
     inline Mapping& getMapping() {
         return instruments;
     }
     Note optionsNoteFromMidiNote(const std::string &instrument, int in_midiOctave, const std::string &letter);
+    // Prefer this for bulk lookups: resolve the instrument once, then index by midi note number
+    // nullptr for an unknown instrument, safe to call from any thread
+    std::shared_ptr<const MidiNoteLookup> noteLookup(const std::string &instrument) const;
+    // Must be called after editing instruments through getMapping()
+    void rebuildLookups();
+    // Changes whenever any field of the instrument mapping or the content of a config/instruments/*.json file changes
+    // Taken by rebuildLookups(), edits to the files on disk show up once the config is parsed or rebuilt again
+    // FNV-1a over the fields themselves, stable across builds so it can key on-disk caches
+    std::uint64_t configFingerprint() const;
 
     inline int notesPerMeasure() {
         return 16;  // for now, just force 16th notes
@@ -57,6 +110,10 @@ private:
     void storeConfigs();
 
     std::map<std::string, Instrument> instruments;
+    // Guards m_lookups / m_configFingerprint, importers read them concurrently while a config edit swaps them
+    mutable std::shared_mutex m_lookupsMutex;
+    std::map<std::string, std::shared_ptr<const MidiNoteLookup>> m_lookups;
+    std::uint64_t m_configFingerprint{0};
     double m_tempo{0.0};
 };
 
@@ -1,6 +1,8 @@
 #include "GwidiOptions2.h"
 #include <spdlog/spdlog.h>
 #include <memory>
+#include <algorithm>
+#include <cassert>
 
 std::shared_ptr<gwidi::options2::HotkeyOptions::HotKey> findHotkey(const std::string &name) {
     auto &hotkeyOptions = gwidi::options2::HotkeyOptions::getInstance();
@@ -15,10 +17,38 @@ std::shared_ptr<gwidi::options2::HotkeyOptions::HotKey> findHotkey(const std::st
     return nullptr;
 }
 
+// The compiled midi note table has to give the same answer as scanning the instrument's octaves
+void testNoteLookup() {
+    const char* letters[12] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+    auto &options = gwidi::options2::GwidiOptions2::getInstance();
+    for(auto &entry : options.getMapping()) {
+        auto lookup = options.noteLookup(entry.first);
+        assert(lookup != nullptr);
+        for(auto midiNote = 0; midiNote < 128; midiNote++) {
+            const gwidi::options2::Note* expected = nullptr;
+            for(auto &octave : entry.second.octaves) {
+                for(auto &note : octave.notes) {
+                    if(!expected && note.midi_octave == midiNote / 12 - 1 && std::find(note.letters.begin(), note.letters.end(), letters[midiNote % 12]) != note.letters.end()) {
+                        expected = &note;
+                    }
+                }
+            }
+            auto actual = lookup->find(midiNote);
+            assert((expected == nullptr) == (actual == nullptr));
+            if(expected) {
+                assert(expected->key == actual->key);
+                assert(expected->instrument_octave == actual->instrument_octave);
+            }
+        }
+    }
+    assert(options.noteLookup("not_an_instrument") == nullptr);
+}
+
 int main() {
     spdlog::set_level(spdlog::level::debug);
     auto &options = gwidi::options2::GwidiOptions2::getInstance();
     spdlog::debug("====Options====\n{}", (std::string)options);
+    testNoteLookup();
 
     auto &hotkeyOptions = gwidi::options2::HotkeyOptions::getInstance();
     auto &mapping = hotkeyOptions.getHotkeyMapping();
@@ -28,6 +28,10 @@ GwidiPlayback::~GwidiPlayback() {
     stop();
 }
 
+void GwidiPlayback::assignData(gwidi::data::midi::GwidiMidiSnapshot data, gwidi::tick::GwidiTickOptions options) {
+    m_handler.setOptions(options);
+    m_handler.assignData(std::move(data));
+}
 void GwidiPlayback::assignData(gwidi::data::midi::GwidiMidiData* data, gwidi::tick::GwidiTickOptions options) {
     m_handler.setOptions(options);
     m_handler.assignData(data);
@@ -36,6 +40,14 @@ void GwidiPlayback::assignData(gwidi::data::gui::GwidiGuiData* data, gwidi::tick
     m_handler.setOptions(options);
     m_handler.assignData(data);
 }
+void GwidiPlayback::assignData(std::shared_ptr<gwidi::data::midi::GwidiMidiStream> stream, gwidi::tick::GwidiTickOptions options) {
+    m_handler.setOptions(options);
+    m_handler.assignData(std::move(stream));
+}
+void GwidiPlayback::assignData(std::shared_ptr<const gwidi::data::midi::GwidiMappedMidiData> data, gwidi::tick::GwidiTickOptions options) {
+    m_handler.setOptions(options);
+    m_handler.assignData(std::move(data));
+}
 
 void GwidiPlayback::sendInput(const std::string &key) {
     if(m_realInput) {
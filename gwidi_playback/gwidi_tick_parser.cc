@@ -1,23 +1,40 @@
 #include <iostream>
 #include <sstream>
 #include <map>
+#include <algorithm>
 #include "spdlog/spdlog.h"
 #include "GwidiTickHandler.h"
 
 namespace gwidi::tick {
 
-void GwidiTickHandler::assignData(gwidi::data::midi::GwidiMidiData *data) {
+void GwidiTickHandler::assignData(gwidi::data::midi::GwidiMidiSnapshot data) {
     auto impl = std::make_shared<GwidiTickHandler_MidiImpl>();
-    impl->assignData(data);
+    impl->assignData(std::move(data));
     m_impl = impl;
 }
 
+void GwidiTickHandler::assignData(gwidi::data::midi::GwidiMidiData *data) {
+    assignData(data ? gwidi::data::midi::GwidiMidiData::snapshot(data->edit()) : gwidi::data::midi::GwidiMidiSnapshot{});
+}
+
 void GwidiTickHandler::assignData(gwidi::data::gui::GwidiGuiData *data) {
     auto impl = std::make_shared<GwidiTickHandler_GuiImpl>();
     impl->assignData(data);
     m_impl = impl;
 }
 
+void GwidiTickHandler::assignData(std::shared_ptr<gwidi::data::midi::GwidiMidiStream> stream) {
+    auto impl = std::make_shared<GwidiTickHandler_StreamImpl>();
+    impl->assignData(std::move(stream));
+    m_impl = impl;
+}
+
+void GwidiTickHandler::assignData(std::shared_ptr<const gwidi::data::midi::GwidiMappedMidiData> data) {
+    auto impl = std::make_shared<GwidiTickHandler_MappedImpl>();
+    impl->assignData(std::move(data));
+    m_impl = impl;
+}
+
 //Note GwidiTickHandler::fromNote(gwidi::data::midi::Note &note) {
 //    return Note{
 //        note.start_offset,
@@ -37,6 +54,33 @@ void GwidiTickHandler::assignData(gwidi::data::gui::GwidiGuiData *data) {
 //    };
 //}
 
+void GwidiTickHandler::filterByTracks(GwidiAction *action) const {
+    if(!action) {
+        return;
+    }
+    auto plays = [this](int track) {
+        if(!options.soloTracks.empty()) {
+            return options.soloTracks.count(track) > 0;
+        }
+        return options.mutedTracks.count(track) == 0;
+    };
+    // Tracks playing the same note together (a duet in unison) still press its key once
+    std::vector<ActionNote> kept;
+    kept.reserve(action->notes.size());
+    for (auto &n: action->notes) {
+        if (!plays(n.track)) {
+            continue;
+        }
+        auto doubled = std::find_if(kept.begin(), kept.end(), [&n](const ActionNote &k) {
+            return k.octave == n.octave && k.key == n.key;
+        }) != kept.end();
+        if (!doubled) {
+            kept.emplace_back(n);
+        }
+    }
+    action->notes = std::move(kept);
+}
+
 void GwidiTickHandler::filterByOctaveBehavior(GwidiAction* action) const {
     if(!action) {
         return;
@@ -97,8 +141,11 @@ void GwidiTickHandler::filterByOctaveBehavior(GwidiAction* action) const {
 GwidiAction *GwidiTickHandler::processTick(double delta) {
     spdlog::debug("processTick, delta: {}", delta);
     cur_time += delta > 0 ? delta / 1000.0 : 0;
+    // Hold at the watermark of a streaming import until more notes arrive
+    cur_time = std::min(cur_time, m_impl->watermark());
 
     GwidiAction* action = m_impl->processTick(cur_time);
+    filterByTracks(action);
     filterByOctaveBehavior(action);
     return action;
 }
@@ -115,8 +162,8 @@ void GwidiTickHandler::reset() {
 }
 
 
-void GwidiTickHandler_MidiImpl::assignData(gwidi::data::midi::GwidiMidiData *data) {
-    m_midi_data = data;
+void GwidiTickHandler_MidiImpl::assignData(gwidi::data::midi::GwidiMidiSnapshot data) {
+    m_midi_data = std::move(data);
 }
 
 GwidiAction *GwidiTickHandler_MidiImpl::processTick(double time) {
@@ -134,27 +181,33 @@ GwidiAction *GwidiTickHandler_MidiImpl::processTick(double time) {
         action->end_reached = true;
     }
 
-    auto floorKey = tickMapFloorKey(time);
+    auto floorIndex = tickMap.floorIndex(time);
     spdlog::debug("processTick, cur_time: {}", time);
     spdlog::debug("processTick, -----BEGIN floorKeys------");
-    if(floorKey != -1.0) {
-        spdlog::debug("key: {}", floorKey);
-        auto &notes = tickMap[floorKey];
+    if(floorIndex != tickMap.npos) {
+        // Tracked on the integer time base, the same key every tick
+        auto floorKey = tickMap.timeAt(floorIndex);
+        spdlog::debug("key: {}", tickMap.keyAt(floorIndex));
+        // The tick map holds references to the notes of every track
+        auto &tracks = m_midi_data->getTracks();
         // TODO: More efficient here would be to remove from the map after we complete the action
         // TODO: Need a feedback mechanism? Maybe not, maybe we just assume the return of the action is enough
         if(m_tick_tracking.find(floorKey) == m_tick_tracking.end()) {
             m_tick_tracking[floorKey] = std::vector<size_t>();
         }
 
-        for (auto &n: notes) {
+        for (auto &ref: tickMap.notesAtIndex(floorIndex)) {
+            auto n = tracks[ref.track].notes.at(ref.index);
             auto &tracking = m_tick_tracking[floorKey];
-            auto hash = n.hash();
+            // Per track, so a track doubling another's note still plays when that one is muted
+            auto hash = n.hash() ^ (std::size_t(ref.track) << 3);
             auto activated = std::find(tracking.begin(), tracking.end(), hash) != tracking.end();
             if(!activated) {
                 ActionNote an{
                         n.start_offset,
                         n.octave,
-                        n.key
+                        n.key.str(),
+                        int(ref.track)
                 };
                 m_tick_tracking[floorKey].emplace_back(hash);
                 action->notes.emplace_back(an);
@@ -171,29 +224,106 @@ double GwidiTickHandler_MidiImpl::tickMapFloorKey(double time) {
         return -1.f;
     }
     auto &tickMap = m_midi_data->getTickMap();
+    auto index = tickMap.floorIndex(time);
+    double bound_key = index == tickMap.npos ? -1.0 : tickMap.keyAt(index);
+    spdlog::debug("currentTickMapFloorKey cur_time: {}, bound_key: {}", time, bound_key);
+
+    return bound_key;
+}
+
+void GwidiTickHandler_MidiImpl::reset() {
+    m_tick_tracking.clear();
+}
+
 
-    double bound_key = -1.0;
-    auto bound_itr = tickMap.lower_bound(time);
 
-    // We have 3 cases:
-    // 1 - cur_time is < all keys, lower_bound returns begin, return first()
-    // 2 - cur_time is > some keys, < some keys, lower_bound returns first >=, return --itr
-    // 3 - cur_time is > all keys, lower_bound returns end, return back()
-    if(bound_itr == tickMap.begin()) {
-        bound_key = bound_itr->first;
+void GwidiTickHandler_StreamImpl::assignData(std::shared_ptr<gwidi::data::midi::GwidiMidiStream> stream) {
+    m_stream = std::move(stream);
+}
+
+GwidiAction *GwidiTickHandler_StreamImpl::processTick(double time) {
+    auto action = new GwidiAction();
+    if (m_stream->finished() && time >= m_stream->duration()) {
+        action->end_reached = true;
     }
-    else if(bound_itr == tickMap.end()) {
-        bound_key = (--tickMap.end())->first;
+
+    std::vector<gwidi::data::midi::Note> notes;
+    auto floorKey = m_stream->floorNotes(time, notes);
+    spdlog::debug("processTick (stream), cur_time: {}, floorKey: {}", time, floorKey);
+    if(floorKey != -1.0) {
+        auto &tracking = m_tick_tracking[gwidi::data::toTimeline(floorKey)];
+        for (auto &n: notes) {
+            auto hash = n.hash();
+            auto activated = std::find(tracking.begin(), tracking.end(), hash) != tracking.end();
+            if(!activated) {
+                tracking.emplace_back(hash);
+                action->notes.emplace_back(ActionNote{
+                        n.start_offset,
+                        n.octave,
+                        n.key.str()
+                });
+            }
+        }
     }
-    else {
-        bound_key = (--bound_itr)->first;
+    return action;
+}
+
+double GwidiTickHandler_StreamImpl::tickMapFloorKey(double time) {
+    if(!m_stream) {
+        return -1.f;
     }
-    spdlog::debug("currentTickMapFloorKey cur_time: {}, bound_key: {}", time, bound_key);
+    return m_stream->tickMapFloorKey(time);
+}
 
-    return bound_key;
+void GwidiTickHandler_StreamImpl::reset() {
+    m_tick_tracking.clear();
 }
 
-void GwidiTickHandler_MidiImpl::reset() {
+
+
+void GwidiTickHandler_MappedImpl::assignData(std::shared_ptr<const gwidi::data::midi::GwidiMappedMidiData> data) {
+    m_data = std::move(data);
+}
+
+GwidiAction *GwidiTickHandler_MappedImpl::processTick(double time) {
+    auto action = new GwidiAction();
+    if (time >= m_data->longestTrackDuration()) {
+        action->end_reached = true;
+    }
+
+    auto range = m_data->floorNotes(time);
+    spdlog::debug("processTick (mapped), cur_time: {}, floorKey: {}", time, range.time);
+    if(range.time != -1.0) {
+        auto &tracking = m_tick_tracking[gwidi::data::toTimeline(range.time)];
+        for (std::size_t i = 0; i < range.size(); i++) {
+            // Only the notes being played are copied out of the file
+            auto ref = range.at(i);
+            auto n = m_data->note(ref);
+            // Per track, as for loaded data
+            auto hash = n.hash() ^ (std::size_t(ref.track) << 3);
+            auto activated = std::find(tracking.begin(), tracking.end(), hash) != tracking.end();
+            if(!activated) {
+                tracking.emplace_back(hash);
+                action->notes.emplace_back(ActionNote{
+                        n.start_offset,
+                        n.octave,
+                        n.key.str(),
+                        int(ref.track)
+                });
+            }
+        }
+    }
+    return action;
+}
+
+double GwidiTickHandler_MappedImpl::tickMapFloorKey(double time) {
+    if(!m_data) {
+        return -1.f;
+    }
+    return m_data->floorNotes(time).time;
+}
+
+void GwidiTickHandler_MappedImpl::reset() {
     m_tick_tracking.clear();
 }
 
@@ -218,12 +348,13 @@ GwidiAction *GwidiTickHandler_GuiImpl::processTick(double time) {
         action->end_reached = true;
     }
 
-    auto floorKey = tickMapFloorKey(time);
+    auto floorIndex = tickMap.floorIndex(time);
     spdlog::debug("processTick, cur_time: {}", time);
     spdlog::debug("processTick, -----BEGIN floorKeys------");
-    if(floorKey != -1.0) {
-        spdlog::debug("key: {}", floorKey);
-        auto &notes = tickMap[floorKey];
+    if(floorIndex != tickMap.npos) {
+        auto floorKey = tickMap.timeAt(floorIndex);
+        spdlog::debug("key: {}", tickMap.keyAt(floorIndex));
+        auto notes = tickMap.notesAtIndex(floorIndex);
         // TODO: More efficient here would be to remove from the map after we complete the action
         // TODO: Need a feedback mechanism? Maybe not, maybe we just assume the return of the action is enough
         if(m_tick_tracking.find(floorKey) == m_tick_tracking.end()) {
@@ -239,7 +370,7 @@ GwidiAction *GwidiTickHandler_GuiImpl::processTick(double time) {
                 ActionNote an{
                     m_gui_data->timeIndexToTickOffset(&n),
                     n.octave,
-                    n.key
+                    n.key.str()
                 };
                 m_tick_tracking[floorKey].emplace_back(hash);
                 action->notes.emplace_back(an);
@@ -256,23 +387,8 @@ double GwidiTickHandler_GuiImpl::tickMapFloorKey(double time) {
         return -1.f;
     }
     auto &tickMap = m_gui_data->getTickMap();
-
-    double bound_key = -1.0;
-    auto bound_itr = tickMap.lower_bound(time);
-
-    // We have 3 cases:
-    // 1 - cur_time is < all keys, lower_bound returns begin, return first()
-    // 2 - cur_time is > some keys, < some keys, lower_bound returns first >=, return --itr
-    // 3 - cur_time is > all keys, lower_bound returns end, return back()
-    if(bound_itr == tickMap.begin()) {
-        bound_key = bound_itr->first;
-    }
-    else if(bound_itr == tickMap.end()) {
-        bound_key = (--tickMap.end())->first;
-    }
-    else {
-        bound_key = (--bound_itr)->first;
-    }
+    auto index = tickMap.floorIndex(time);
+    double bound_key = index == tickMap.npos ? -1.0 : tickMap.keyAt(index);
     spdlog::debug("currentTickMapFloorKey cur_time: {}, bound_key: {}", time, bound_key);
 
     return bound_key;
@@ -27,8 +27,15 @@ public:
     explicit GwidiPlayback(const std::string &instrument);
     ~GwidiPlayback();
 
+    // Plays a shared song snapshot, the editor can keep showing (and editing a copy of) the same one
+    void assignData(gwidi::data::midi::GwidiMidiSnapshot data, gwidi::tick::GwidiTickOptions options);
+    // Deprecated, plays a copy of data taken now, the caller keeps ownership of data
     void assignData(gwidi::data::midi::GwidiMidiData* data, gwidi::tick::GwidiTickOptions options);
     void assignData(gwidi::data::gui::GwidiGuiData* data, gwidi::tick::GwidiTickOptions options);
+    // Starts on the first notes of a streaming import, see GwidiMidiParser::readFileStreaming
+    void assignData(std::shared_ptr<gwidi::data::midi::GwidiMidiStream> stream, gwidi::tick::GwidiTickOptions options);
+    // Plays a saved song straight from its mapped .gwd file, see GwidiMappedMidiData
+    void assignData(std::shared_ptr<const gwidi::data::midi::GwidiMappedMidiData> data, gwidi::tick::GwidiTickOptions options);
 
     inline void setTickCb(TickCbFn cb) {
         m_tickCbFn = cb;
@@ -2,10 +2,14 @@
 #define GWIDI_MIDI_PARSER_GWIDITICKHANDLER_H
 
 #include <memory>
+#include <limits>
+#include <set>
 
 #include "GwidiOptions2.h"
 
 #include "GwidiMidiData.h"
+#include "GwidiMidiStream.h"
+#include "GwidiMappedMidiData.h"
 #include "GwidiGuiData.h"
 #include "gwidi_midi_parser.h"
 
@@ -15,6 +19,7 @@ struct ActionNote {
     double start_offset;
     int octave;
     std::string key;
+    int track{0};   // slot in GwidiMidiData::getTracks(), 0 for data with one track
 };
 
 struct GwidiAction {
@@ -31,6 +36,9 @@ struct GwidiTickOptions {
     };
 
     ActionOctaveBehavior octaveBehavior{ActionOctaveBehavior{LOWEST}};
+    // Applied every tick, so changing them through setOptions takes effect while playing
+    std::set<int> mutedTracks{};
+    std::set<int> soloTracks{};     // when not empty, only these tracks play
 };
 
 class GwidiTickHandler_Impl {
@@ -39,13 +47,18 @@ public:
     virtual GwidiAction* processTick(double time) = 0;
     virtual bool hasData() = 0;
     virtual void reset() = 0;
+    // Playback time can't move past this, data after it isn't there yet
+    virtual double watermark() {
+        return std::numeric_limits<double>::infinity();
+    }
 };
 
 class GwidiTickHandler_MidiImpl : public GwidiTickHandler_Impl {
 public:
-    using TickMapTrackingType = std::map<double, std::vector<size_t>>; // int is a hash of the note's attributes (start_offset, octave, key)
+    using TickMapTrackingType = std::map<gwidi::data::TimelineTime, std::vector<size_t>>; // int is a hash of the note's attributes (start_offset, octave, key)
 
-    void assignData(gwidi::data::midi::GwidiMidiData* data);
+    // Shares the snapshot, the song stays alive while it plays
+    void assignData(gwidi::data::midi::GwidiMidiSnapshot data);
 
     double tickMapFloorKey(double time) override;
     GwidiAction* processTick(double time)  override;
@@ -57,13 +70,59 @@ public:
     void reset() override;
 
 private:
-    gwidi::data::midi::GwidiMidiData* m_midi_data{nullptr};
+    gwidi::data::midi::GwidiMidiSnapshot m_midi_data;
+    TickMapTrackingType m_tick_tracking;
+};
+
+// Plays a GwidiMidiStream while the import is still filling it
+class GwidiTickHandler_StreamImpl : public GwidiTickHandler_Impl {
+public:
+    using TickMapTrackingType = std::map<gwidi::data::TimelineTime, std::vector<size_t>>; // int is a hash of the note's attributes (start_offset, octave, key)
+
+    void assignData(std::shared_ptr<gwidi::data::midi::GwidiMidiStream> stream);
+
+    double tickMapFloorKey(double time) override;
+    GwidiAction* processTick(double time)  override;
+
+    inline bool hasData() override {
+        return m_stream != nullptr;
+    }
+
+    inline double watermark() override {
+        return m_stream ? m_stream->watermark() : 0.0;
+    }
+
+    void reset() override;
+
+private:
+    std::shared_ptr<gwidi::data::midi::GwidiMidiStream> m_stream;
+    TickMapTrackingType m_tick_tracking;
+};
+
+// Plays a mapped .gwd file without loading it
+class GwidiTickHandler_MappedImpl : public GwidiTickHandler_Impl {
+public:
+    using TickMapTrackingType = std::map<gwidi::data::TimelineTime, std::vector<size_t>>; // int is a hash of the note's attributes (start_offset, octave, key)
+
+    void assignData(std::shared_ptr<const gwidi::data::midi::GwidiMappedMidiData> data);
+
+    double tickMapFloorKey(double time) override;
+    GwidiAction* processTick(double time)  override;
+
+    inline bool hasData() override {
+        return m_data && m_data->isOpen();
+    }
+
+    void reset() override;
+
+private:
+    std::shared_ptr<const gwidi::data::midi::GwidiMappedMidiData> m_data;
     TickMapTrackingType m_tick_tracking;
 };
 
 class GwidiTickHandler_GuiImpl : public GwidiTickHandler_Impl {
 public:
-    using TickMapTrackingType = std::map<double, std::vector<size_t>>; // int is a hash of the note's attributes (start_offset, octave, key)
+    using TickMapTrackingType = std::map<gwidi::data::TimelineTime, std::vector<size_t>>; // int is a hash of the note's attributes (start_offset, octave, key)
 
     void assignData(gwidi::data::gui::GwidiGuiData* data);
 
@@ -84,8 +143,13 @@ private:
 class GwidiTickHandler {
 public:
     void setOptions(GwidiTickOptions options);
+    void assignData(gwidi::data::midi::GwidiMidiSnapshot data);
+    // Deprecated, plays a copy of data taken now, the caller keeps ownership of data
+    // Use the snapshot overload, it shares the song instead of copying it
     void assignData(gwidi::data::midi::GwidiMidiData* data);
     void assignData(gwidi::data::gui::GwidiGuiData* data);
+    void assignData(std::shared_ptr<gwidi::data::midi::GwidiMidiStream> stream);
+    void assignData(std::shared_ptr<const gwidi::data::midi::GwidiMappedMidiData> data);
     GwidiAction* processTick(double delta);
 
     void reset();
@@ -100,6 +164,7 @@ public:
 
 private:
     std::shared_ptr<GwidiTickHandler_Impl> m_impl;
+    void filterByTracks(GwidiAction *action) const;
     void filterByOctaveBehavior(GwidiAction *action) const;\
 
 
@@ -1,6 +1,8 @@
 #include <spdlog/spdlog.h>
 #include "GwidiTickHandler.h"
 #include "GwidiPlayback.h"
+#include <atomic>
+#include <thread>
 
 #if defined(WIN32) || defined(WIN64)
 #include "WindowsSendInput.h"
@@ -12,7 +14,7 @@
 #endif
 
 void testMidi() {
-    auto data = gwidi::midi::GwidiMidiParser::getInstance().readFile(TEST_FILE, gwidi::midi::MidiParseOptions {
+    auto data = gwidi::midi::GwidiMidiParser::getInstance().readSnapshot(TEST_FILE, gwidi::midi::MidiParseOptions {
         "default",
         1
     });
@@ -27,8 +29,6 @@ void testMidi() {
     while(playback.isPlaying()) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
-
-    delete data;    // we COULD delete this earlier, after the assignData -> the tickmap in playback is a copy
 }
 
 void testGui() {
@@ -88,10 +88,169 @@ void testGui() {
     delete data;    // we COULD delete this earlier, after the assignData -> the tickmap in playback is a copy
 }
 
+void testStream() {
+    auto stream = std::make_shared<gwidi::data::midi::GwidiMidiStream>();
+    gwidi::tick::GwidiTickHandler handler;
+    handler.assignData(stream);
+
+    // Nothing decoded yet, time can't move
+    delete handler.processTick(500);
+    assert(handler.curTime() == 0.0);
+
+    stream->append({gwidi::data::midi::Note{0.0, 0.5, 0, "C", "", 0, "1"}, gwidi::data::midi::Note{0.5, 0.5, 0, "D", "", 0, "2"}}, 1.0);
+    auto action = handler.processTick(2000);
+    assert(handler.curTime() == 1.0);   // held at the watermark
+    assert(action->notes.size() == 1 && action->notes.front().key == "2");
+    assert(!action->end_reached);
+    delete action;
+
+    stream->append({gwidi::data::midi::Note{1.5, 0.5, 0, "E", "", 0, "3"}}, 2.0);
+    stream->finish(2.0);
+    action = handler.processTick(2000);
+    assert(handler.curTime() == 3.0);
+    assert(action->notes.size() == 1 && action->notes.front().key == "3");
+    assert(action->end_reached);
+    delete action;
+}
+
+void testMapped() {
+    // Written out of start order, so the mapped file has to index it
+    gwidi::data::midi::GwidiMidiData data;
+    data.addTrack("default", "mapped", {
+            gwidi::data::midi::Note{0.5, 0.5, 0, "D", "", 0, "2"},
+            gwidi::data::midi::Note{0.0, 0.5, 0, "C", "", 0, "1"},
+            gwidi::data::midi::Note{1.5, 0.5, 0, "E", "", 0, "3"}
+    }, 2.0);
+    data.writeToFile("tick_mapped.gwd");
+
+    auto mapped = std::make_shared<gwidi::data::midi::GwidiMappedMidiData>();
+    assert(mapped->open("tick_mapped.gwd", true));
+    gwidi::tick::GwidiTickHandler handler;
+    handler.assignData(mapped);
+
+    auto action = handler.processTick(1000);
+    assert(action->notes.size() == 1 && action->notes.front().key == "2");
+    assert(!action->end_reached);
+    delete action;
+
+    action = handler.processTick(2000);
+    assert(action->notes.size() == 1 && action->notes.front().key == "3");
+    assert(action->end_reached);
+    delete action;
+
+    // Every track of the file plays, not only the first
+    data.addTrack("default", "second", {
+            gwidi::data::midi::Note{0.5, 0.5, 1, "F", "", 1, "4"},
+            gwidi::data::midi::Note{1.0, 0.5, 1, "G", "", 1, "5"}
+    }, 2.0);
+    data.writeToFile("tick_mapped.gwd");
+    auto tracks = std::make_shared<gwidi::data::midi::GwidiMappedMidiData>();
+    assert(tracks->open("tick_mapped.gwd", true));
+    gwidi::tick::GwidiTickHandler multi;
+    multi.assignData(tracks);
+
+    action = multi.processTick(1000);
+    assert(action->notes.size() == 2 && action->notes[0].key == "2" && action->notes[1].key == "4");
+    assert(action->notes[0].track == 0 && action->notes[1].track == 1);
+    delete action;
+    action = multi.processTick(500);
+    assert(action->notes.size() == 1 && action->notes.front().key == "5" && action->notes.front().track == 1);
+    delete action;
+}
+
+void testSnapshot() {
+    auto data = new gwidi::data::midi::GwidiMidiData();
+    data->addTrack("default", "snapshot", {
+            gwidi::data::midi::Note{0.0, 0.5, 0, "C", "", 0, "1"},
+            gwidi::data::midi::Note{0.5, 0.5, 0, "D", "", 0, "2"}
+    }, 1.0);
+    data->fillTickMap();
+    auto song = gwidi::data::midi::GwidiMidiData::snapshot(data);
+
+    // Several players share the one song, each on its own thread
+    std::vector<std::thread> players;
+    std::atomic<int> played{0};
+    for(auto i = 0; i < 4; i++) {
+        players.emplace_back([song, &played]() {
+            gwidi::tick::GwidiTickHandler handler;
+            handler.assignData(song);
+            auto action = handler.processTick(600);
+            if(action->notes.size() == 1 && action->notes.front().key == "2") {
+                played++;
+            }
+            delete action;
+        });
+    }
+    for(auto &player : players) {
+        player.join();
+    }
+    assert(played == 4);
+
+    // An edit is a new snapshot, a handler still playing the old one doesn't see it
+    gwidi::tick::GwidiTickHandler handler;
+    handler.assignData(song);
+    auto edit = song->edit();
+    edit->assignNotes(0, {gwidi::data::midi::Note{0.0, 0.5, 0, "E", "", 0, "3"}});
+    edit->fillTickMap();
+    auto edited = gwidi::data::midi::GwidiMidiData::snapshot(edit);
+    assert(edited->getTracks().front().notes.size() == 1 && song->getTracks().front().notes.size() == 2);
+    assert(edited->fingerprint() != song->fingerprint());
+
+    // Dropping every other reference keeps the song alive for its player
+    song.reset();
+    auto action = handler.processTick(100);
+    assert(action->notes.size() == 1 && action->notes.front().key == "1");
+    delete action;
+}
+
+void testTracks() {
+    // A duet, both voices start on the same note
+    auto data = new gwidi::data::midi::GwidiMidiData();
+    data->addTrack("default", "melody", {
+            gwidi::data::midi::Note{0.0, 0.5, 0, "C", "", 0, "1"},
+            gwidi::data::midi::Note{0.5, 0.5, 0, "D", "", 0, "2"}
+    }, 1.0);
+    data->addTrack("default", "harmony", {
+            gwidi::data::midi::Note{0.0, 0.5, 0, "C", "", 1, "1"},
+            gwidi::data::midi::Note{0.0, 0.5, 0, "E", "", 1, "3"}
+    }, 1.0);
+    auto song = gwidi::data::midi::GwidiMidiData::snapshot(data);
+
+    auto play = [&song](gwidi::tick::GwidiTickOptions options) {
+        gwidi::tick::GwidiTickHandler handler;
+        handler.setOptions(options);
+        handler.assignData(song);
+        auto action = handler.processTick(0);
+        std::vector<std::string> keys;
+        for(auto &n : action->notes) {
+            keys.emplace_back(n.key);
+        }
+        delete action;
+        return keys;
+    };
+    // The unison note is pressed once
+    assert((play({}) == std::vector<std::string>{"1", "3"}));
+
+    gwidi::tick::GwidiTickOptions muted;
+    muted.mutedTracks = {0};
+    assert((play(muted) == std::vector<std::string>{"1", "3"}));
+    muted.mutedTracks = {1};
+    assert((play(muted) == std::vector<std::string>{"1"}));
+
+    gwidi::tick::GwidiTickOptions solo;
+    solo.mutedTracks = {1};
+    solo.soloTracks = {1};
+    assert((play(solo) == std::vector<std::string>{"1", "3"}));
+}
+
 int main() {
 
     spdlog::set_level(spdlog::level::debug);
 
+    testStream();
+    testMapped();
+    testSnapshot();
+    testTracks();
     testMidi();
     testGui();
 